@@ -4,6 +4,7 @@
 find_package(Boost 1.56.0 COMPONENTS unit_test_framework program_options REQUIRED)
 find_package(Git QUIET) # if we don't find git or FindGit.cmake is not on the system we ignore it.
 find_package(CURL REQUIRED)
+find_package(Threads REQUIRED)
 find_package(PpConsul)
 find_package(RapidJSON)
 
@@ -40,6 +41,7 @@ o2_define_bucket(
     ${CURL_LIBRARIES}
     ${Boost_PROGRAM_OPTIONS_LIBRARY}
     ${MYSQL_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT}
 
     SYSTEMINCLUDE_DIRECTORIES
     ${Boost_INCLUDE_DIR}
@@ -58,6 +60,7 @@ o2_define_bucket(
     ${CURL_LIBRARIES}
     ${PPCONSUL_LIBRARIES}
     ${Common_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT}
 
     SYSTEMINCLUDE_DIRECTORIES
     ${CURL_INCLUDE_DIRS}
@@ -0,0 +1,161 @@
+/// \file CachingBackend.h
+/// \brief Configuration interface that caches the values of another one
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_CACHINGBACKEND_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_CACHINGBACKEND_H_
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/core/noncopyable.hpp>
+#include "Configuration/ConfigurationInterface.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Backends
+{
+
+/// Decorator that caches the results of getString() and getRecursive() of another configuration interface, for
+/// configurations that are read repeatedly from a remote backend.
+///
+/// Values are kept for a limited time (TTL), in a least-recently-used cache bounded by an amount of entries and of
+/// bytes. Values that do not exist are cached too, so probing optional values does not go to the backend every time.
+/// The cache is split in shards with their own lock, so threads can get cached values concurrently. Calls that go to
+/// the wrapped backend are serialised.
+///
+/// Paths are cached as given, so paths that the wrapped backend considers the same, like "a/b" and "/a/b", are cached
+/// separately. Puts are written through to the wrapped backend, and remove the value and the cached subtrees containing
+/// it. Changing the prefix or separator clears the cache. Changes made by others are seen once the TTL expires.
+///
+/// The factory wraps a backend in a cache with the "cache+" prefix, for example:
+///   cache+consul://localhost:8500/prefix?ttl=5s&max=100000&max_bytes=67108864
+/// The TTL takes a unit of ms, s or m. The other parameters are "shards", and "cache_missing=false" (or 0) to not cache
+/// missing values. The parameters not given keep their default values, and invalid ones throw std::runtime_error.
+///
+/// Example:
+///   \snippet test/TestConfiguration.cxx [Caching backend]
+class CachingBackend final : public ConfigurationInterface, public boost::noncopyable
+{
+  public:
+    struct Parameters
+    {
+        /// How long values are kept. Zero keeps them until they are evicted.
+        std::chrono::milliseconds ttl = std::chrono::seconds(5);
+
+        /// Maximum amount of cached values and subtrees
+        std::size_t maxEntries = 100000;
+
+        /// Maximum amount of bytes of the cached values and subtrees, estimated like Tree::heapBytes() does
+        std::size_t maxBytes = 64 << 20;
+
+        /// Amount of independently locked parts of the cache. The bounds are divided between them, rounding up, so a
+        /// shard may evict before the whole cache is full.
+        std::size_t shards = 16;
+
+        /// Also cache that values do not exist
+        bool cacheMissing = true;
+    };
+
+    /// Counters of the cache since it was created
+    struct Stats
+    {
+        /// Gets answered by the cache, including the ones answering that a value does not exist
+        std::size_t hits = 0;
+
+        /// Gets answered by the cache that a value does not exist
+        std::size_t missingHits = 0;
+
+        /// Gets that went to the wrapped backend
+        std::size_t misses = 0;
+
+        /// Entries removed to stay within the bounds
+        std::size_t evictions = 0;
+
+        /// Entries removed because their TTL expired
+        std::size_t expirations = 0;
+
+        /// Entries removed by puts
+        std::size_t invalidations = 0;
+
+        /// Current amount of entries
+        std::size_t entries = 0;
+
+        /// Current estimated bytes of the entries
+        std::size_t bytes = 0;
+    };
+
+    /// \param backend The backend to cache
+    /// \param parameters The bounds of the cache
+    CachingBackend(std::unique_ptr<ConfigurationInterface> backend, const Parameters& parameters);
+    CachingBackend(std::unique_ptr<ConfigurationInterface> backend);
+    virtual ~CachingBackend();
+
+    virtual void putString(const std::string& path, const std::string& value) override;
+    virtual void putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic = false) override;
+    virtual auto getString(const std::string& path) -> Optional<std::string> override;
+    virtual auto getString(const Path& path) -> Optional<std::string> override;
+
+    /// Gets the cached values from the cache, and the others with one getMany() of the wrapped backend
+    virtual auto getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>> override;
+
+    /// Cached values are returned in a ready future. Others are requested asynchronously from the wrapped backend, and
+    /// are not cached.
+    virtual auto getStringAsync(const std::string& path) -> std::future<Optional<std::string>> override;
+    virtual auto putStringAsync(const std::string& path, const std::string& value) -> std::future<void> override;
+    virtual void setPrefix(const std::string& prefix) override;
+    virtual void setPathSeparator(char separator) override;
+    virtual void resetPathSeparator() override;
+    virtual auto getRecursive(const std::string& path) -> Tree::Node override;
+    virtual auto getRecursiveShared(const std::string& path) -> Tree::SharedNode override;
+    virtual auto getRecursiveAsync(const std::string& path) -> std::future<Tree::Node> override;
+
+    /// Watches the wrapped backend, and removes the values it reports as changed from the cache before calling the
+    /// callback, so they are seen before the TTL expires. The watch is cancelled when the CachingBackend is destroyed,
+    /// so the handle may outlive it.
+    virtual auto watch(const std::string& path, WatchCallback callback) -> std::unique_ptr<Watch> override;
+    virtual auto getRecursiveMap(const std::string& path) -> KeyValueMap override;
+
+    /// Loads the snapshot from the wrapped backend, rather than from a cached tree
+    virtual auto reload() -> std::shared_ptr<const Snapshot> override;
+    virtual auto memoryUsage() const -> std::size_t override;
+
+    /// Gets the counters of the cache
+    Stats getStats() const;
+
+    /// Removes all entries from the cache
+    void clear();
+
+  private:
+    class Cache;
+    class CachingWatch;
+    struct Watches;
+
+    /// Removes the value at the path and the cached subtrees that may contain it
+    void invalidate(const std::string& path);
+
+    std::unique_ptr<ConfigurationInterface> mBackend;
+
+    /// Serialises the calls to mBackend, which is not thread-safe
+    mutable std::mutex mBackendMutex;
+
+    std::unique_ptr<Cache> mCache;
+    const bool mCacheMissing;
+
+    /// Watches of the wrapped backend, shared with their handles
+    std::shared_ptr<Watches> mWatches;
+};
+
+} // namespace Backends
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_CACHINGBACKEND_H_ */
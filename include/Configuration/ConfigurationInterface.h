@@ -6,10 +6,19 @@
 #ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATIONINTERFACE_H_
 #define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATIONINTERFACE_H_
 
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <boost/optional.hpp>
+#include "Configuration/Result.h"
+#include "Configuration/SharedNode.h"
+#include "Configuration/Snapshot.h"
 #include "Configuration/Tree.h"
+#include "Configuration/Watch.h"
 
 namespace AliceO2
 {
@@ -32,6 +41,55 @@ class ConfigurationInterface
     template <typename T> using Optional = boost::optional<T>; // Hopefully, we can move to std::optional someday.
     using KeyValueMap = std::unordered_map<std::string, std::string>;
 
+    /// A precompiled path, for values that are retrieved repeatedly.
+    /// The path is hashed once, on construction. Backends use it as a key to cache whatever they resolve the path to (a
+    /// node, a remote key...), so repeated gets with the same Path skip that work. The path is kept as given, so it
+    /// resolves exactly like the string it was built from.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Path handle]
+    class Path
+    {
+      public:
+        /// \param path The path of the value
+        explicit Path(const std::string& path);
+
+        /// The path as given
+        const std::string& string() const
+        {
+          return mPath;
+        }
+
+        /// Hash of the path
+        std::size_t hash() const
+        {
+          return mHash;
+        }
+
+        bool operator==(const Path& other) const
+        {
+          return mHash == other.mHash && mPath == other.mPath;
+        }
+
+        bool operator!=(const Path& other) const
+        {
+          return !(*this == other);
+        }
+
+        /// Hash function object, for using Path as key in unordered containers
+        struct Hash
+        {
+            std::size_t operator()(const Path& path) const
+            {
+              return path.hash();
+            }
+        };
+
+      private:
+        std::string mPath;
+        std::size_t mHash;
+    };
+
     virtual ~ConfigurationInterface();
 
     /// Puts a string into the configuration.
@@ -49,11 +107,75 @@ class ConfigurationInterface
     /// \param value The value to put
     virtual void putFloat(const std::string& path, double value);
 
+    /// Puts several values into the configuration at once.
+    /// The default implementation puts the values one by one: strings with putString(), ints and bools with putInt()
+    /// and doubles with putFloat(). Arrays are put as strings, see Tree::convert(). Backends override it to send the
+    /// values in bulk.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Put many]
+    ///
+    /// \param pairs The paths and values to put
+    /// \param atomic If true, either all values are put or none are. Otherwise, a failure may leave some values put.
+    /// \throw std::runtime_error if atomic is true and the backend cannot guarantee it for this amount of values
+    virtual void putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic = false);
+
     /// Retrieves a string value from the configuration.
     /// \param path The path of the value
     /// \return The retrieved value
     virtual Optional<std::string> getString(const std::string& path) = 0;
 
+    /// Retrieves a string value from the configuration, using a precompiled path.
+    /// The default implementation redirects to getString() with the path string.
+    /// \param path The path of the value
+    /// \return The retrieved value
+    virtual Optional<std::string> getString(const Path& path);
+
+    /// Retrieves several string values from the configuration at once.
+    /// The default implementation calls getString() for every path. Backends override it to resolve the whole batch in
+    /// a single traversal or round trip, which is much cheaper for the many values a component reads at startup.
+    /// \param paths The paths of the values
+    /// \return The retrieved values, in the order of the paths. Values that do not exist are empty.
+    virtual std::vector<Optional<std::string>> getMany(const std::vector<std::string>& paths);
+
+    /// Retrieves a string value from the configuration without blocking the caller.
+    /// The default implementation calls getString() and returns a future that is already ready, which suits backends
+    /// that do not wait on I/O. Backends that do run the request on a pool of I/O threads, so many requests can be in
+    /// flight at once. The path is resolved against the prefix and separator in effect at the time of the call.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Async]
+    ///
+    /// \param path The path of the value
+    /// \return Future of the retrieved value, or of the exception the request threw
+    virtual std::future<Optional<std::string>> getStringAsync(const std::string& path);
+
+    /// Puts a string into the configuration without blocking the caller. See getStringAsync().
+    /// \param path The path of the value
+    /// \param value The value to put
+    /// \return Future that is ready when the value is put, or holds the exception the request threw
+    virtual std::future<void> putStringAsync(const std::string& path, const std::string& value);
+
+    /// Gets key-values recursively from the given path without blocking the caller. See getStringAsync().
+    /// \param path The path of the values to get
+    /// \return Future of a tree containing the values that were retrieved, or of the exception the request threw
+    virtual std::future<Tree::Node> getRecursiveAsync(const std::string& path);
+
+    /// Subscribes to changes of the values under the given path, instead of polling getRecursive() for them.
+    /// Changes are relative to the values at the time of the call, and are delivered in batches as the backend sees
+    /// them, to a callback running on a thread of the watch. The default implementation throws, for backends that
+    /// cannot be watched.
+    /// The watch must be cancelled, by destroying its handle, before this object is destroyed.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Watch]
+    ///
+    /// \param path The path of the values to watch
+    /// \param callback Function called with the values that changed
+    /// \return Handle of the watch, which cancels it when destroyed
+    /// \throw std::runtime_error if the backend does not support watching, or the initial values could not be read
+    virtual std::unique_ptr<Watch> watch(const std::string& path, WatchCallback callback);
+
     /// Retrieves an integer value from the configuration.
     /// \param path The path of the value
     /// \return The retrieved value
@@ -78,6 +200,35 @@ class ConfigurationInterface
     template<typename T>
     Optional<T> get(const std::string& path);
 
+    /// Template convenience interface for get operations using a precompiled path.
+    /// Redirects to getString(const Path&), and converts the value.
+    /// \tparam T The type of the value. Supported types are "std::string", "int" and "double"
+    /// \param path The path of the value
+    /// \return The retrieved value
+    template<typename T>
+    Optional<T> get(const Path& path);
+
+    /// Template interface for get operations that are expected to miss often, such as optional parameters.
+    /// Unlike get(), a value that cannot be converted gives an error instead of throwing, so neither a missing nor a
+    /// malformed value costs an exception.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Try get]
+    ///
+    /// \tparam T The type of the value. Supported types are "std::string", "int" and "double"
+    /// \param path The path of the value
+    /// \return The retrieved value, or LookupError::NotFound or LookupError::ConversionFailed
+    template<typename T>
+    Result<T> tryGet(const std::string& path);
+
+    /// Template interface for get operations that are expected to miss often, using a precompiled path.
+    /// See tryGet(const std::string&).
+    /// \tparam T The type of the value. Supported types are "std::string", "int" and "double"
+    /// \param path The path of the value
+    /// \return The retrieved value, or LookupError::NotFound or LookupError::ConversionFailed
+    template<typename T>
+    Result<T> tryGet(const Path& path);
+
     /// Checks if the given value exists.
     /// Note: this function should not be used in a "if this value exists, then get the value" pattern, as it is not a
     /// trivial operation for every backend. This pattern is supported in a more lightweight manner by the optional
@@ -86,9 +237,16 @@ class ConfigurationInterface
     /// \return A boolean: true indicates it exists, false indicates it doesn't
     virtual bool exists(const std::string& path);
 
+    /// Checks if the given value exists, using a precompiled path.
+    /// \param path The path of the value
+    /// \return A boolean: true indicates it exists, false indicates it doesn't
+    virtual bool exists(const Path& path);
+
     /// Sets a 'prefix' or 'directory' for the backend.
     /// After this call, all paths given to this object will be prefixed with this.
     /// The implementation of this is very backend-dependent and it may not be a trivial call.
+    /// The current snapshot is not affected, so snapshot() keeps returning the values under the previous prefix until
+    /// reload() is called.
     /// \param prefix The prefix path
     virtual void setPrefix(const std::string& prefix) = 0;
 
@@ -110,10 +268,52 @@ class ConfigurationInterface
     /// \return A tree containing the values that were retrieved
     virtual Tree::Node getRecursive(const std::string& path) = 0;
 
+    /// Gets key-values recursively from the given path and converts them into a shared, immutable tree structure.
+    /// Backends that keep the whole tree in memory can return a handle to it in O(1) instead of copying.
+    /// The default implementation wraps the result of getRecursive().
+    /// \param path The path of the values to get
+    /// \return A handle to a tree containing the values that were retrieved
+    virtual Tree::SharedNode getRecursiveShared(const std::string& path);
+
     /// Gets key-values recursively from the given path
     /// \param path The path of the values to get
     /// \return A map containing the key-values
     virtual KeyValueMap getRecursiveMap(const std::string& path) = 0;
+
+    /// Gets the current snapshot of the values under the prefix, loading the first one with reload() if there is none.
+    /// Unlike the rest of this interface, it is thread-safe: any amount of threads can call it, and read the snapshots
+    /// it returns, while another thread calls reload(). Getting the snapshot takes no lock of this object, and reading
+    /// it takes none at all, so threads should get a snapshot once per unit of work and read everything from it.
+    ///
+    /// Example:
+    ///   \snippet test/TestConfiguration.cxx [Snapshot]
+    ///
+    /// \return The latest snapshot published by reload()
+    std::shared_ptr<const Snapshot> snapshot();
+
+    /// Builds a new snapshot from getRecursiveShared() of the prefix, and publishes it atomically, so snapshot()
+    /// returns either the previous or the new one. Threads still holding a previous snapshot can keep reading it, and
+    /// it is freed when the last of them releases it.
+    /// It can run concurrently with snapshot(), but not with the other functions of this interface.
+    /// \return The new snapshot
+    virtual std::shared_ptr<const Snapshot> reload();
+
+    /// Estimates the memory held by this object: the object itself, and the heap memory of the trees and caches it
+    /// keeps. Memory held by client libraries, such as connection buffers, is not included.
+    /// The default implementation returns 0, meaning the backend does not account for its memory.
+    /// \return The estimated amount of bytes
+    virtual std::size_t memoryUsage() const;
+
+  private:
+    /// Loads the first snapshot with reload(), unless another thread did so first
+    std::shared_ptr<const Snapshot> loadIfEmpty();
+
+    /// Latest snapshot, only accessed with std::atomic_load() and std::atomic_store()
+    std::shared_ptr<const Snapshot> mSnapshot;
+
+    /// Serialises the reloads, so versions are increasing. It is recursive so that loadIfEmpty() can hold it while
+    /// calling reload(), which backends may override.
+    std::recursive_mutex mReloadMutex;
 };
 
 } // namespace Configuration
@@ -0,0 +1,333 @@
+/// \file FlatTree.h
+/// \brief Definition of the FlatTree, a compact immutable representation of a Tree::Node
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_FLATTREE_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_FLATTREE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+#include "Configuration/TreeHash.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Immutable, flattened representation of a tree.
+///
+/// Where a Node allocates a separate map node for every key, the FlatTree stores all nodes in one contiguous array.
+/// The children of a branch are stored next to each other, sorted by key, so a branch is just an offset range into
+/// that array and a lookup is a binary search over it. All keys, string values and arrays live in a single arena, and
+/// the other leaf values are stored inline in the node array.
+///
+/// Once built, lookups through getSubtree() and get() do not allocate (except for the returned value itself when
+/// converting to std::string).
+///
+/// Every entry also carries the content hash of its subtree (see TreeHash.h), computed when the tree is built, so
+/// comparing subtrees of FlatTrees costs a single hash comparison.
+///
+/// Since the node array and the string arena contain offsets rather than pointers, they can be written to a file as
+/// they are with writeFile(), and used straight from the file with mapFile(), without any parsing. Copies of a FlatTree
+/// share the same immutable storage.
+///
+/// Binary file layout (version 2), in native byte order:
+///   * header: magic "O2CFTREE", format version, byte order mark, size of an Entry, then the amount of entries, the
+///     size of the string arena, the offsets of both in the file, and a checksum of both
+///   * the node array, as an array of Entry
+///   * the string arena, aligned to ARRAY_ALIGNMENT so the arrays in it are too
+/// Files are only readable on machines with the same byte order, and by the same format version. The entries contain
+/// content hashes, so the version must change when the hash function does.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [FlatTree]
+class FlatTree
+{
+  public:
+    /// Type of the value held by an entry
+    enum class Type : std::uint32_t
+    {
+      Branch,
+      String,
+      Int,
+      Double,
+      Bool,
+      DoubleArray,
+      IntArray
+    };
+
+    /// An entry of the node array
+    struct Entry
+    {
+        std::uint32_t keyOffset; ///< Offset of the key in the string arena
+        std::uint32_t keyLength; ///< Length of the key
+        Type type; ///< Type of the entry
+        std::uint32_t size; ///< Branch: amount of children. String: length of the value. Array: amount of elements.
+        union
+        {
+            std::uint64_t offset; ///< Branch: index of the first child. String, array: offset in the string arena.
+            std::int64_t integer;
+            double floating;
+            std::uint8_t boolean; ///< Not bool, since a mapped file may hold any byte here, which is true if not 0
+        } value;
+        Hash hash; ///< Content hash of the subtree, equal to Tree::hash() of the corresponding Node
+    };
+
+    /// Lightweight handle to an entry of a FlatTree. It is only valid as long as the FlatTree it refers to.
+    /// A default-constructed Reference refers to nothing, which is how lookups signal a missing path.
+    class Reference
+    {
+      public:
+        Reference() = default;
+
+        /// Returns true if this refers to an entry
+        explicit operator bool() const
+        {
+          return mTree != nullptr;
+        }
+
+        /// Type of the referred entry
+        Type type() const
+        {
+          return entry().type;
+        }
+
+        bool isBranch() const
+        {
+          return type() == Type::Branch;
+        }
+
+        bool isLeaf() const
+        {
+          return !isBranch();
+        }
+
+        /// Key of the referred entry. The root has an empty key.
+        boost::string_view key() const;
+
+        /// Amount of children if this is a branch, 0 otherwise
+        std::size_t size() const
+        {
+          return isBranch() ? entry().size : 0;
+        }
+
+        /// Gets a child by position. Children are sorted by key.
+        Reference child(std::size_t index) const;
+
+        /// Finds a direct child by key
+        /// \return The child, or an empty Reference if this is not a branch or it has no such child
+        Reference find(boost::string_view key) const;
+
+        /// Gets a subtree based on a path relative to this entry. Accepts the same paths as Tree::getSubtree().
+        /// \return The subtree, or an empty Reference if the path does not exist
+        Reference getSubtree(boost::string_view path) const;
+
+        /// Gets the value of a string leaf without copying it
+        /// \return The value, or an empty string_view if this is not a string leaf
+        boost::string_view getStringView() const;
+
+        /// Gets a view of the elements of an array leaf without copying them, aligned like Tree::getArray() gives them.
+        /// T must be double or std::int64_t.
+        /// \return The view, or an empty view if this is not an array leaf of the given type
+        template <class T>
+        ArrayView<T> getArray() const;
+
+        /// Gets the value of a leaf, converted to T like Tree::convert() would.
+        /// \return The value, or none if this is not a leaf
+        template <class T>
+        Optional<T> get() const;
+
+        /// Shorthand for getSubtree(path).get<T>()
+        template <class T>
+        Optional<T> get(boost::string_view path) const
+        {
+          if (auto reference = getSubtree(path)) {
+            return reference.get<T>();
+          }
+          return boost::none;
+        }
+
+        /// Content hash of the referred subtree. Equal to Tree::hash() of the corresponding Node.
+        Hash hash() const
+        {
+          return entry().hash;
+        }
+
+        /// Converts the referred entry back to a Leaf. Only valid if this is a leaf.
+        Leaf getLeaf() const;
+
+        /// Converts the referred subtree back into a Node
+        Node toNode() const;
+
+      private:
+        friend class FlatTree;
+
+        Reference(const FlatTree* tree, std::uint32_t index) : mTree(tree), mIndex(index)
+        {
+        }
+
+        const Entry& entry() const
+        {
+          return mTree->mEntries[mIndex];
+        }
+
+        const FlatTree* mTree = nullptr;
+        std::uint32_t mIndex = 0;
+    };
+
+    /// Creates an empty tree, consisting of a root branch without children
+    FlatTree();
+
+    /// Flattens the given tree
+    explicit FlatTree(const Node& node);
+
+    /// The root of the tree
+    Reference root() const
+    {
+      return Reference(this, 0);
+    }
+
+    /// Gets a subtree based on a path string. See Reference::getSubtree().
+    Reference getSubtree(boost::string_view path) const
+    {
+      return root().getSubtree(path);
+    }
+
+    /// Gets and converts a leaf value based on a path string. See Reference::get().
+    template <class T>
+    Optional<T> get(boost::string_view path) const
+    {
+      return root().get<T>(path);
+    }
+
+    /// Converts the tree back into a Node
+    Node toNode() const
+    {
+      return root().toNode();
+    }
+
+    /// Amount of entries (branches and leaves, including the root) in the tree
+    std::size_t size() const
+    {
+      return mEntryCount;
+    }
+
+    /// Amount of bytes used by the tree, including its storage, which may be shared with copies or mapped from a file
+    std::size_t memoryUsage() const
+    {
+      return sizeof(FlatTree) + mEntryCount * sizeof(Entry) + mStringsSize;
+    }
+
+    /// Writes the tree to a file in the binary format described above.
+    /// The contents are written to a temporary file in the same directory, which then replaces the file atomically, so
+    /// processes that have the old file mapped keep using it unchanged.
+    /// \throw std::runtime_error if the file could not be written
+    void writeFile(const std::string& filePath) const;
+
+    /// Memory-maps a file written by writeFile() and uses it directly as storage.
+    /// This reads the header and the node array, checking that all offsets in them stay inside the file so that a
+    /// corrupted file cannot lead to out-of-bounds reads, but not the string arena. The pages are mapped read-only and
+    /// shared, so processes mapping the same file share them too.
+    /// \param filePath File to map
+    /// \param verifyChecksum Also verify the checksum of the contents. This reads the whole file, but also detects
+    ///   corrupted keys and values.
+    /// \throw std::runtime_error if the file could not be mapped, is not in the right format, or fails verification
+    static auto mapFile(const std::string& filePath, bool verifyChecksum = false) -> FlatTree;
+
+  private:
+    auto getString(std::uint64_t offset, std::uint32_t length) const -> boost::string_view
+    {
+      return boost::string_view(mStrings + offset, length);
+    }
+
+    /// Keeps the storage the pointers below point into alive, either a buffer built by the constructor or a mapped file
+    std::shared_ptr<const void> mStorage;
+
+    /// Node array, in breadth-first order so the children of each branch are contiguous
+    const Entry* mEntries = nullptr;
+    std::size_t mEntryCount = 0;
+
+    /// Arena holding all keys and string values
+    const char* mStrings = nullptr;
+    std::size_t mStringsSize = 0;
+};
+
+namespace FlatTreeImplementation
+{
+/// Converts a string value to T without intermediate std::string
+template <class T>
+T convertString(boost::string_view value)
+{
+  return boost::lexical_cast<T>(value.data(), value.size());
+}
+
+template <>
+inline std::string convertString<std::string>(boost::string_view value)
+{
+  return std::string(value.data(), value.size());
+}
+} // namespace FlatTreeImplementation
+
+template <class T>
+auto FlatTree::Reference::get() const -> Optional<T>
+{
+  const Entry& e = entry();
+  switch (e.type) {
+    case Type::Branch:
+      return boost::none;
+    case Type::String:
+      return FlatTreeImplementation::convertString<T>(getStringView());
+    case Type::Int:
+      return convert<T>(Leaf(int(e.value.integer)));
+    case Type::Double:
+      return convert<T>(Leaf(e.value.floating));
+    case Type::Bool:
+      return convert<T>(Leaf(e.value.boolean != 0));
+    case Type::DoubleArray:
+    case Type::IntArray:
+      return convert<T>(getLeaf());
+  }
+  return boost::none;
+}
+
+namespace FlatTreeImplementation
+{
+template <class T>
+struct ArrayType;
+
+template <>
+struct ArrayType<double>
+{
+    static constexpr FlatTree::Type value = FlatTree::Type::DoubleArray;
+};
+
+template <>
+struct ArrayType<std::int64_t>
+{
+    static constexpr FlatTree::Type value = FlatTree::Type::IntArray;
+};
+} // namespace FlatTreeImplementation
+
+template <class T>
+auto FlatTree::Reference::getArray() const -> ArrayView<T>
+{
+  const Entry& e = entry();
+  if (e.type != FlatTreeImplementation::ArrayType<T>::value) {
+    return {};
+  }
+  return ArrayView<T>(reinterpret_cast<const T*>(mTree->mStrings + e.value.offset), e.size);
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_FLATTREE_H_ */
@@ -0,0 +1,110 @@
+/// \file Result.h
+/// \brief Result of a lookup that may fail, without exceptions
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_RESULT_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_RESULT_H_
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/throw_exception.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+
+/// Reason a lookup did not give a value
+enum class LookupError
+{
+  NotFound, ///< The path does not exist, or does not lead to a value
+  ConversionFailed ///< The value exists, but cannot be converted to the requested type
+};
+
+/// Gives a description of the error, for messages
+inline const char* toString(LookupError error)
+{
+  switch (error) {
+    case LookupError::NotFound:
+      return "not found";
+    case LookupError::ConversionFailed:
+      return "conversion failed";
+  }
+  return "unknown error";
+}
+
+/// Either a value or the reason there is none, like std::expected.
+/// Used by lookups that are expected to miss often, so that a miss is as cheap as a hit: nothing is thrown unless
+/// value() is called on a result without value.
+template <class T>
+class Result
+{
+  public:
+    Result(T value) : mValue(std::move(value))
+    {
+    }
+
+    Result(LookupError error) : mError(error)
+    {
+    }
+
+    bool hasValue() const
+    {
+      return mValue.is_initialized();
+    }
+
+    explicit operator bool() const
+    {
+      return hasValue();
+    }
+
+    /// \throw std::runtime_error if there is no value
+    const T& value() const
+    {
+      if (!hasValue()) {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("Result has no value: ") + toString(mError)));
+      }
+      return *mValue;
+    }
+
+    /// Accesses the value, which must be present
+    const T& operator*() const
+    {
+      return *mValue;
+    }
+
+    const T* operator->() const
+    {
+      return mValue.get_ptr();
+    }
+
+    /// Gives the value, or the fallback if there is none
+    T valueOr(T fallback) const
+    {
+      return hasValue() ? *mValue : std::move(fallback);
+    }
+
+    /// The reason there is no value. Only meaningful if hasValue() is false.
+    LookupError error() const
+    {
+      return mError;
+    }
+
+    /// Drops the reason, for code that only cares whether there is a value
+    const boost::optional<T>& optional() const
+    {
+      return mValue;
+    }
+
+  private:
+    boost::optional<T> mValue;
+    LookupError mError = LookupError::NotFound;
+};
+
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_RESULT_H_ */
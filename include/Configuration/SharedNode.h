@@ -0,0 +1,120 @@
+/// \file SharedNode.h
+/// \brief Definition of the SharedNode, a reference-counted immutable handle to a tree or subtree
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SHAREDNODE_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SHAREDNODE_H_
+
+#include <memory>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Reference-counted, immutable handle to a tree or to one of its subtrees.
+///
+/// Copying a SharedNode or taking a subtree of it is O(1): all handles share the same underlying tree, which is
+/// freed when the last handle to any part of it is gone. A mutable copy is only made when someone calls mutate() while
+/// other handles share the tree (copy-on-write), and then only of the subtree this handle refers to.
+///
+/// Note: the reference counting is thread-safe, but mutate() on a handle must not race with other threads copying
+/// that same handle.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [SharedNode]
+class SharedNode
+{
+  public:
+    /// Creates a handle to an empty branch
+    SharedNode() : SharedNode(Branch())
+    {
+    }
+
+    /// Creates a handle that takes ownership of the given tree
+    explicit SharedNode(Node node) : mNode(std::make_shared<Node>(std::move(node)))
+    {
+    }
+
+    const Node& get() const
+    {
+      return *mNode;
+    }
+
+    const Node& operator*() const
+    {
+      return *mNode;
+    }
+
+    const Node* operator->() const
+    {
+      return mNode.get();
+    }
+
+    /// Allows passing a SharedNode to the Tree helper functions directly
+    operator const Node&() const
+    {
+      return *mNode;
+    }
+
+    /// Gets a subtree based on a path string, sharing ownership with this handle. See Tree::getSubtree().
+    SharedNode getSubtree(boost::string_view path) const
+    {
+      return SharedNode(mNode, &Tree::getSubtree(*mNode, path));
+    }
+
+    /// Gets a subtree based on a path string, sharing ownership with this handle, without throwing. See Tree::find().
+    /// \return The subtree, or nothing if the path does not exist
+    boost::optional<SharedNode> tryGetSubtree(boost::string_view path) const
+    {
+      const Node* node = Tree::find(*mNode, path);
+      if (node == nullptr) {
+        return boost::none;
+      }
+      return SharedNode(mNode, node);
+    }
+
+    /// Returns true if no other handle shares the underlying tree
+    bool unique() const
+    {
+      return mNode.use_count() == 1;
+    }
+
+    /// Gets mutable access to the node. If other handles share the underlying tree, the node is first copied, so
+    /// the change is not visible to them.
+    Node& mutate()
+    {
+      if (!unique()) {
+        mNode = std::make_shared<Node>(*mNode);
+      }
+      // Every Node is allocated non-const by this class, so casting away const is safe
+      return const_cast<Node&>(*mNode);
+    }
+
+    /// Makes a deep copy of the node
+    Node materialise() const
+    {
+      return *mNode;
+    }
+
+  private:
+    /// Aliasing constructor: refers to node, but shares ownership with owner
+    SharedNode(const std::shared_ptr<const Node>& owner, const Node* node) : mNode(owner, node)
+    {
+    }
+
+    std::shared_ptr<const Node> mNode;
+};
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SHAREDNODE_H_ */
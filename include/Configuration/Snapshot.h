@@ -0,0 +1,70 @@
+/// \file Snapshot.h
+/// \brief Immutable, versioned copy of a configuration, for sharing between threads
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SNAPSHOT_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SNAPSHOT_H_
+
+#include <cstdint>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/SharedNode.h"
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+
+/// The values of a configuration at one point in time, see ConfigurationInterface::snapshot().
+/// A snapshot never changes after it is created, so any amount of threads can read it at once without locking. A
+/// reload publishes a new snapshot with a higher version instead of modifying this one.
+class Snapshot
+{
+  public:
+    /// \param tree The values
+    /// \param version Number of the snapshot, higher for newer snapshots of the same configuration
+    Snapshot(Tree::SharedNode tree, std::uint64_t version) : mTree(std::move(tree)), mVersion(version)
+    {
+    }
+
+    std::uint64_t version() const
+    {
+      return mVersion;
+    }
+
+    const Tree::Node& tree() const
+    {
+      return *mTree;
+    }
+
+    /// Handle to the tree, to keep a part of it after the snapshot is released
+    const Tree::SharedNode& sharedTree() const
+    {
+      return mTree;
+    }
+
+    /// Gets and converts the value at a path, without throwing. See Tree::tryGet().
+    template <class T>
+    boost::optional<T> get(boost::string_view path) const
+    {
+      return Tree::tryGet<T>(*mTree, path);
+    }
+
+    /// Gets a subtree, sharing ownership with the snapshot. See SharedNode::tryGetSubtree().
+    boost::optional<Tree::SharedNode> getSubtree(boost::string_view path) const
+    {
+      return mTree.tryGetSubtree(path);
+    }
+
+  private:
+    const Tree::SharedNode mTree;
+    const std::uint64_t mVersion;
+};
+
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_SNAPSHOT_H_ */
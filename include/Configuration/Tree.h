@@ -6,15 +6,37 @@
 #ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREE_H_
 #define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
 #include <string>
 #include <map>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
 #include <vector>
+#include <boost/align/aligned_allocator.hpp>
 #include <boost/optional.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/utility/string_view.hpp>
 #include <boost/variant/get.hpp>
 #include <boost/variant/variant.hpp>
 #include <boost/variant/recursive_variant.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
+#include "Configuration/TreeConfig.h"
 #include "Configuration/Visitor.h"
+#ifdef CONFIGURATION_FLAT_BRANCH
+#include <boost/container/flat_map.hpp>
+#endif
 
 namespace AliceO2
 {
@@ -35,21 +57,476 @@ namespace Tree
 {
 template <typename T> using Optional = boost::optional<T>; // Hopefully, we can move to std::optional someday.
 
+/// Alignment in bytes of the elements of array leaves, enough for the widest vector instructions
+constexpr std::size_t ARRAY_ALIGNMENT = 64;
+
+/// Contiguous array of numbers, for leaves holding many values such as calibration tables.
+/// The elements are aligned to ARRAY_ALIGNMENT, so they can be processed with aligned vector instructions.
+template <class T>
+class Array
+{
+  public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    Array() = default;
+
+    Array(std::initializer_list<T> values) : mValues(values)
+    {
+    }
+
+    template <class Iterator>
+    Array(Iterator first, Iterator last) : mValues(first, last)
+    {
+    }
+
+    const T* data() const
+    {
+      return mValues.data();
+    }
+
+    T* data()
+    {
+      return mValues.data();
+    }
+
+    std::size_t size() const
+    {
+      return mValues.size();
+    }
+
+    bool empty() const
+    {
+      return mValues.empty();
+    }
+
+    const T* begin() const
+    {
+      return data();
+    }
+
+    const T* end() const
+    {
+      return data() + size();
+    }
+
+    const T& operator[](std::size_t index) const
+    {
+      return mValues[index];
+    }
+
+    T& operator[](std::size_t index)
+    {
+      return mValues[index];
+    }
+
+    void push_back(T value)
+    {
+      mValues.push_back(value);
+    }
+
+    void reserve(std::size_t size)
+    {
+      mValues.reserve(size);
+    }
+
+    bool operator==(const Array& other) const
+    {
+      return mValues == other.mValues;
+    }
+
+    bool operator!=(const Array& other) const
+    {
+      return mValues != other.mValues;
+    }
+
+    bool operator<(const Array& other) const
+    {
+      return mValues < other.mValues;
+    }
+
+  private:
+    std::vector<T, boost::alignment::aligned_allocator<T, ARRAY_ALIGNMENT>> mValues;
+};
+
+using DoubleArray = Array<double>;
+using IntArray = Array<std::int64_t>;
+
+/// Writes the elements of an array separated by commas, each as boost::lexical_cast would
+template <class T>
+std::ostream& operator<<(std::ostream& stream, const Array<T>& array)
+{
+  for (std::size_t i = 0; i < array.size(); ++i) {
+    if (i != 0) {
+      stream << ',';
+    }
+    stream << boost::lexical_cast<std::string>(array[i]);
+  }
+  return stream;
+}
+
+namespace LeafImplementation
+{
+/// Heap block holding a value shared by the copies of a Leaf
+struct SharedBase
+{
+    mutable std::atomic<std::uint32_t> references {1};
+};
+
+template <class T>
+struct Shared : SharedBase
+{
+    explicit Shared(T&& initialValue) : value(std::move(initialValue))
+    {
+    }
+
+    const T value;
+};
+} // namespace LeafImplementation
+
+/// Value of a leaf of the tree: a std::string, int, double, bool, DoubleArray or IntArray.
+///
+/// A Leaf takes 16 bytes. Numbers and strings of up to INLINE_CAPACITY characters are stored inline. Longer strings
+/// and arrays are stored in an immutable heap block shared by all copies of the leaf, so copying a leaf never copies
+/// its contents.
+///
+/// It can be used like the boost::variant it replaces: it is visited with Visitor::apply() or boost::apply_visitor()
+/// with one function per type, converted with convert(), and compared with ==, != and <. Visitation is a switch on
+/// the type. Visitors receive strings as a const std::string&, which for inline strings refers to a temporary that
+/// fits in std::string's small string buffer, so it does not allocate either.
+class Leaf
+{
+  public:
+    /// Type of the value. The order is that of the types of the boost::variant Leaf used to be.
+    enum class Type : std::uint8_t
+    {
+      String,
+      Int,
+      Double,
+      Bool,
+      DoubleArray,
+      IntArray
+    };
+
+    /// Length of the longest string that is stored inline
+    static constexpr std::size_t INLINE_CAPACITY = 14;
+
+    /// Creates an empty string, like a default-constructed boost::variant would
+    Leaf() : mSize(0), mType(Type::String)
+    {
+    }
+
+    Leaf(const std::string& value)
+    {
+      setString(value.data(), value.size(), [&] { return std::string(value); });
+    }
+
+    Leaf(std::string&& value)
+    {
+      setString(value.data(), value.size(), [&] { return std::move(value); });
+    }
+
+    Leaf(const char* value) : Leaf(boost::string_view(value))
+    {
+    }
+
+    explicit Leaf(boost::string_view value)
+    {
+      setString(value.data(), value.size(), [&] { return value.to_string(); });
+    }
+
+    Leaf(int value) : mSize(0), mType(Type::Int)
+    {
+      new (mStorage) int(value);
+    }
+
+    Leaf(double value) : mSize(0), mType(Type::Double)
+    {
+      new (mStorage) double(value);
+    }
+
+    Leaf(bool value) : mSize(0), mType(Type::Bool)
+    {
+      new (mStorage) bool(value);
+    }
+
+    Leaf(DoubleArray value)
+    {
+      setShared(Type::DoubleArray, std::move(value));
+    }
+
+    Leaf(IntArray value)
+    {
+      setShared(Type::IntArray, std::move(value));
+    }
+
+    Leaf(const Leaf& other)
+    {
+      copyFrom(other);
+      if (isShared()) {
+        shared()->references.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    Leaf(Leaf&& other) noexcept
+    {
+      copyFrom(other);
+      other.mSize = 0;
+      other.mType = Type::String;
+    }
+
+    Leaf& operator=(const Leaf& other)
+    {
+      Leaf copy(other);
+      return *this = std::move(copy);
+    }
+
+    Leaf& operator=(Leaf&& other) noexcept
+    {
+      if (this != &other) {
+        release();
+        copyFrom(other);
+        other.mSize = 0;
+        other.mType = Type::String;
+      }
+      return *this;
+    }
+
+    ~Leaf()
+    {
+      release();
+    }
+
+    /// Type of the value
+    Type getType() const
+    {
+      return mType;
+    }
+
+    /// Index of the type of the value, like boost::variant::which()
+    int which() const
+    {
+      return int(mType);
+    }
+
+    /// Type of the value, like boost::variant::type()
+    const std::type_info& type() const;
+
+    /// Returns true if the value is stored in a heap block shared with the copies of this leaf, rather than inline
+    bool isShared() const
+    {
+      return mSize == SHARED;
+    }
+
+    /// Gets the value of a string leaf without copying it
+    /// \return The value, or an empty string_view if this is not a string leaf
+    boost::string_view getStringView() const
+    {
+      if (mType != Type::String) {
+        return {};
+      }
+      if (isShared()) {
+        const auto& value = sharedValue<std::string>();
+        return boost::string_view(value.data(), value.size());
+      }
+      return boost::string_view(mStorage, mSize);
+    }
+
+    /// Gets a pointer to the value, if it is of type T. T must be int, double, bool, DoubleArray or IntArray; use
+    /// getStringView() for strings, which may not be stored in a std::string.
+    /// \return The value, or nullptr if the leaf holds another type
+    template <class T>
+    const T* getIf() const;
+
+    /// Heap bytes of the shared block holding the value, not including memory allocated by the value itself, or 0 if
+    /// the value is stored inline
+    std::size_t sharedBytes() const;
+
+    /// Calls the visitor with the value. This is what boost::apply_visitor() calls, see Visitor::apply().
+    template <class Visitor>
+    typename Visitor::result_type apply_visitor(Visitor& visitor) const
+    {
+      switch (mType) {
+        case Type::String:
+          if (isShared()) {
+            return visitor(sharedValue<std::string>());
+          }
+          return visitor(std::string(mStorage, mSize));
+        case Type::Int:
+          return visitor(*reinterpret_cast<const int*>(mStorage));
+        case Type::Double:
+          return visitor(*reinterpret_cast<const double*>(mStorage));
+        case Type::Bool:
+          return visitor(*reinterpret_cast<const bool*>(mStorage));
+        case Type::DoubleArray:
+          return visitor(sharedValue<DoubleArray>());
+        case Type::IntArray:
+          break;
+      }
+      return visitor(sharedValue<IntArray>());
+    }
+
+    friend bool operator==(const Leaf& a, const Leaf& b);
+
+    friend bool operator!=(const Leaf& a, const Leaf& b)
+    {
+      return !(a == b);
+    }
+
+    /// Orders by type first, then by value, like boost::variant does
+    friend bool operator<(const Leaf& a, const Leaf& b);
+
+  private:
+    /// Value of mSize for shared values
+    static constexpr std::uint8_t SHARED = 0xff;
+
+    template <class MakeString>
+    void setString(const char* data, std::size_t size, MakeString makeString)
+    {
+      if (size <= INLINE_CAPACITY) {
+        std::memcpy(mStorage, data, size);
+        mSize = std::uint8_t(size);
+        mType = Type::String;
+      } else {
+        setShared(Type::String, makeString());
+      }
+    }
+
+    template <class T>
+    void setShared(Type type, T value)
+    {
+      const LeafImplementation::SharedBase* shared = new LeafImplementation::Shared<T>(std::move(value));
+      new (mStorage) const LeafImplementation::SharedBase*(shared);
+      mSize = SHARED;
+      mType = type;
+    }
+
+    void copyFrom(const Leaf& other)
+    {
+      std::memcpy(mStorage, other.mStorage, sizeof(mStorage));
+      mSize = other.mSize;
+      mType = other.mType;
+    }
+
+    const LeafImplementation::SharedBase* shared() const
+    {
+      return *reinterpret_cast<const LeafImplementation::SharedBase* const*>(mStorage);
+    }
+
+    template <class T>
+    const T& sharedValue() const
+    {
+      return static_cast<const LeafImplementation::Shared<T>*>(shared())->value;
+    }
+
+    void release()
+    {
+      if (isShared() && shared()->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        destroyShared();
+      }
+    }
+
+    void destroyShared();
+
+    /// The inline value: a number, the characters of a string, or a pointer to the shared block
+    alignas(8) char mStorage[INLINE_CAPACITY];
+
+    /// Length of an inline string, SHARED for shared values, 0 otherwise
+    std::uint8_t mSize;
+
+    Type mType;
+};
+
+namespace LeafImplementation
+{
+template <class T>
+struct TypeOf;
+
+template <>
+struct TypeOf<int>
+{
+    static constexpr Leaf::Type value = Leaf::Type::Int;
+};
+
+template <>
+struct TypeOf<double>
+{
+    static constexpr Leaf::Type value = Leaf::Type::Double;
+};
+
+template <>
+struct TypeOf<bool>
+{
+    static constexpr Leaf::Type value = Leaf::Type::Bool;
+};
+
+template <>
+struct TypeOf<DoubleArray>
+{
+    static constexpr Leaf::Type value = Leaf::Type::DoubleArray;
+};
+
+template <>
+struct TypeOf<IntArray>
+{
+    static constexpr Leaf::Type value = Leaf::Type::IntArray;
+};
+} // namespace LeafImplementation
+
+template <class T>
+const T* Leaf::getIf() const
+{
+  if (mType != LeafImplementation::TypeOf<T>::value) {
+    return nullptr;
+  }
+  if (isShared()) {
+    return &sharedValue<T>();
+  }
+  return reinterpret_cast<const T*>(mStorage);
+}
+
+/// Writes the value like the boost::variant Leaf did
+std::ostream& operator<<(std::ostream& stream, const Leaf& leaf);
+
 /// Node is a recursive boost::variant. This allows us to model the hierarchy of directories and files, as well as
 /// key-value hierarchies.
+/// The branch map uses a transparent comparator, so it can be searched with a boost::string_view without first copying
+/// the key into a std::string.
+/// The branch map is a std::map, or a sorted contiguous boost::container::flat_map when the library is built with the
+/// CONFIGURATION_FLAT_BRANCH option (see TreeConfig.h). Both have the same interface, but with the flat map, inserting
+/// into or erasing from a branch invalidates references to its other children.
 using Node = boost::make_recursive_variant<
-    boost::variant<std::string, int, double, bool>, // Leaf node
-    std::map<std::string, boost::recursive_variant_> // Branch node; mapped_type is recursive (can be Leaf or Branch)
+    Leaf, // Leaf node
+#ifdef CONFIGURATION_FLAT_BRANCH
+    boost::container::flat_map<std::string, boost::recursive_variant_, std::less<>> // Branch node; mapped_type is recursive
+#else
+    std::map<std::string, boost::recursive_variant_, std::less<>> // Branch node; mapped_type is recursive
+#endif
     >::type;
 
-/// Type for "leaf" nodes in the tree that contain the values
-/// The boost::variant allows us to accommodate different value types
-using Leaf = Node::types::item; // This refers to the first type of the Node variant;
-
 /// The map used for branch nodes in the tree
 /// It can contain a TreeLeaf or another TreeBranch
 using Branch = Node::types::next::item; // This refers to the second type of the Node variant
 
+/// Helper function to get a child of a Branch without throwing, and without converting the key to a std::string.
+/// Call it qualified, as Tree::find(), since argument-dependent lookup may also find boost::find().
+/// \return The child, or nullptr if the branch has no such key
+inline const Node* find(const Branch& branch, boost::string_view key)
+{
+  auto iter = branch.find(key);
+  return iter == branch.end() ? nullptr : &iter->second;
+}
+
+/// Helper function to get a child of a Branch, like Branch::at() but without converting the key to a std::string
+inline const Node& at(const Branch& branch, boost::string_view key)
+{
+  auto iter = branch.find(key);
+  if (iter == branch.end()) {
+    BOOST_THROW_EXCEPTION(std::out_of_range("Key '" + key.to_string() + "' not found in branch"));
+  }
+  return iter->second;
+}
+
 /// Helper function to extract a Branch type from the Node variant
 inline const Branch& getBranch(const Node& node)
 {
@@ -57,9 +534,9 @@ inline const Branch& getBranch(const Node& node)
 }
 
 /// Helper function to get a Branch value from the Node (which is assumed to be a Branch)
-inline const Branch& getBranch(const Node& node, const std::string& key)
+inline const Branch& getBranch(const Node& node, boost::string_view key)
 {
-  return getBranch(boost::get<Branch>(node).at(key));
+  return getBranch(at(boost::get<Branch>(node), key));
 }
 
 /// Helper function to extract a Leaf type from the Node variant
@@ -69,32 +546,170 @@ inline const Leaf& getLeaf(const Node& node)
 }
 
 /// Helper function to get a Leaf value from the Node (which is assumed to be a Branch)
-inline const Leaf& getLeaf(const Node& node, const std::string& key)
+inline const Leaf& getLeaf(const Node& node, boost::string_view key)
 {
-  return getLeaf(boost::get<Branch>(node).at(key));
+  return getLeaf(at(boost::get<Branch>(node), key));
 }
 
-/// Helper function to convert a Leaf variant to another data type using boost::lexical_cast.
-/// If the source and target types are the same, no conversion is performed.
+namespace ConvertImplementation
+{
+/// Arrays only convert to a string, with the elements separated by commas
 template <class T>
-T convert(const Leaf& variant)
+struct ArrayConverter
 {
-  if (variant.type() == typeid(T)) {
-    // If the variant contains type T, no conversion is needed
-    return boost::get<T>(variant);
-  } else {
-    // Else, try to convert
-    try {
-      return Visitor::apply<T>(variant,
-          [](const std::string& value) { return boost::lexical_cast<T>(value); },
-          [](int value) { return boost::lexical_cast<T>(value); },
-          [](bool value) { return boost::lexical_cast<T>(value); },
-          [](double value) { return boost::lexical_cast<T>(value); });
+    template <class Element>
+    static T convert(const Array<Element>&)
+    {
+      BOOST_THROW_EXCEPTION(boost::bad_lexical_cast(typeid(Array<Element>), typeid(T)));
     }
-    catch (const boost::bad_lexical_cast& e) {
-      BOOST_THROW_EXCEPTION(e);
+
+    template <class Element>
+    static bool tryConvert(const Array<Element>&, T&)
+    {
+      return false;
+    }
+};
+
+template <>
+struct ArrayConverter<std::string>
+{
+    template <class Element>
+    static std::string convert(const Array<Element>& array)
+    {
+      return boost::lexical_cast<std::string>(array);
+    }
+
+    template <class Element>
+    static bool tryConvert(const Array<Element>& array, std::string& result)
+    {
+      return boost::conversion::try_lexical_convert(array, result);
     }
+};
+
+/// Converts a scalar value, without going through boost::lexical_cast if it already has the target type
+template <class T, class From>
+T convertValue(const From& value, std::true_type)
+{
+  return value;
+}
+
+template <class T, class From>
+T convertValue(const From& value, std::false_type)
+{
+  return boost::lexical_cast<T>(value);
+}
+
+template <class T, class From>
+T convertValue(const From& value)
+{
+  return convertValue<T>(value, std::is_same<T, From>());
+}
+
+/// Converts a string value, which is copied directly if the target type is a string
+template <class T>
+T convertString(boost::string_view value)
+{
+  return boost::lexical_cast<T>(value.data(), value.size());
+}
+
+template <>
+inline std::string convertString<std::string>(boost::string_view value)
+{
+  return std::string(value.data(), value.size());
+}
+
+/// Non-throwing versions of convertValue() and convertString(), returning false if the value cannot be converted
+template <class T, class From>
+bool tryConvertValue(const From& value, T& result, std::true_type)
+{
+  result = value;
+  return true;
+}
+
+template <class T, class From>
+bool tryConvertValue(const From& value, T& result, std::false_type)
+{
+  return boost::conversion::try_lexical_convert(value, result);
+}
+
+template <class T, class From>
+bool tryConvertValue(const From& value, T& result)
+{
+  return tryConvertValue(value, result, std::is_same<T, From>());
+}
+
+template <class T>
+bool tryConvertString(boost::string_view value, T& result)
+{
+  return boost::conversion::try_lexical_convert(value.data(), value.size(), result);
+}
+
+inline bool tryConvertString(boost::string_view value, std::string& result)
+{
+  result.assign(value.data(), value.size());
+  return true;
+}
+} // namespace ConvertImplementation
+
+/// Helper function to convert a Leaf to another data type using boost::lexical_cast.
+/// If the source and target types are the same, no conversion is performed.
+/// Array leaves can only be converted to a string, see getArray() to access them.
+template <class T>
+T convert(const Leaf& leaf)
+{
+  try {
+    switch (leaf.getType()) {
+      case Leaf::Type::String:
+        return ConvertImplementation::convertString<T>(leaf.getStringView());
+      case Leaf::Type::Int:
+        return ConvertImplementation::convertValue<T>(*leaf.getIf<int>());
+      case Leaf::Type::Double:
+        return ConvertImplementation::convertValue<T>(*leaf.getIf<double>());
+      case Leaf::Type::Bool:
+        return ConvertImplementation::convertValue<T>(*leaf.getIf<bool>());
+      case Leaf::Type::DoubleArray:
+        return ConvertImplementation::ArrayConverter<T>::convert(*leaf.getIf<DoubleArray>());
+      case Leaf::Type::IntArray:
+        break;
+    }
+    return ConvertImplementation::ArrayConverter<T>::convert(*leaf.getIf<IntArray>());
+  }
+  catch (const boost::bad_lexical_cast& e) {
+    BOOST_THROW_EXCEPTION(e);
+  }
+}
+
+/// Like convert(), but returns nothing instead of throwing when the leaf cannot be converted, so failed conversions
+/// cost about as much as successful ones
+template <class T>
+Optional<T> tryConvert(const Leaf& leaf)
+{
+  T result {};
+  bool converted = false;
+  switch (leaf.getType()) {
+    case Leaf::Type::String:
+      converted = ConvertImplementation::tryConvertString(leaf.getStringView(), result);
+      break;
+    case Leaf::Type::Int:
+      converted = ConvertImplementation::tryConvertValue(*leaf.getIf<int>(), result);
+      break;
+    case Leaf::Type::Double:
+      converted = ConvertImplementation::tryConvertValue(*leaf.getIf<double>(), result);
+      break;
+    case Leaf::Type::Bool:
+      converted = ConvertImplementation::tryConvertValue(*leaf.getIf<bool>(), result);
+      break;
+    case Leaf::Type::DoubleArray:
+      converted = ConvertImplementation::ArrayConverter<T>::tryConvert(*leaf.getIf<DoubleArray>(), result);
+      break;
+    case Leaf::Type::IntArray:
+      converted = ConvertImplementation::ArrayConverter<T>::tryConvert(*leaf.getIf<IntArray>(), result);
+      break;
+  }
+  if (!converted) {
+    return boost::none;
   }
+  return result;
 }
 
 /// Helper function to extract and convert a Leaf type from the Node variant
@@ -106,14 +721,14 @@ T getRequired(const Node& node)
 
 /// Helper function to extract and convert a Leaf type from a Branch
 template <class T>
-T getRequired(const Branch& branch, const std::string& key)
+T getRequired(const Branch& branch, boost::string_view key)
 {
-  return convert<T>(getLeaf(branch.at(key)));
+  return convert<T>(getLeaf(at(branch, key)));
 }
 
 /// Helper function to extract and convert a Leaf type from a Branch
 template <class T>
-T getRequired(const Node& node, const std::string& key)
+T getRequired(const Node& node, boost::string_view key)
 {
   return getRequired<T>(getBranch(node), key);
 }
@@ -129,7 +744,7 @@ Optional<T> get(const Node& node)
 
 /// Helper function to extract and convert a Leaf type from a Branch
 template <class T>
-Optional<T> get(const Branch& node, const std::string& key)
+Optional<T> get(const Branch& node, boost::string_view key)
 {
   auto iter = node.find(key);
   if (iter != node.end()) {
@@ -141,11 +756,85 @@ Optional<T> get(const Branch& node, const std::string& key)
 
 /// Helper function to extract and convert a Leaf type from a Branch
 template <class T>
-Optional<T> get(const Node& node, const std::string& key)
+Optional<T> get(const Node& node, boost::string_view key)
 {
   return get<T>(getBranch(node), key);
 }
 
+/// Read-only view of the elements of an array leaf
+template <class T>
+class ArrayView
+{
+  public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    ArrayView() = default;
+
+    ArrayView(const T* data, std::size_t size) : mData(data), mSize(size)
+    {
+    }
+
+    /// Pointer to the elements. Aligned to ARRAY_ALIGNMENT when viewing an Array.
+    const T* data() const
+    {
+      return mData;
+    }
+
+    std::size_t size() const
+    {
+      return mSize;
+    }
+
+    bool empty() const
+    {
+      return mSize == 0;
+    }
+
+    const T* begin() const
+    {
+      return mData;
+    }
+
+    const T* end() const
+    {
+      return mData + mSize;
+    }
+
+    const T& operator[](std::size_t index) const
+    {
+      return mData[index];
+    }
+
+  private:
+    const T* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+/// Gets a view of the elements of an array leaf, without copying them.
+/// Only valid as long as the node it refers to. T must be double or std::int64_t.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Array leaves]
+///
+/// \throw boost::bad_get if the node is not an array leaf of the given type
+template <class T>
+ArrayView<T> getArray(const Node& node)
+{
+  const auto* array = getLeaf(node).getIf<Array<T>>();
+  if (array == nullptr) {
+    BOOST_THROW_EXCEPTION(boost::bad_get());
+  }
+  return ArrayView<T>(array->data(), array->size());
+}
+
+/// Gets a view of the elements of an array leaf in a branch. See getArray(const Node&).
+template <class T>
+ArrayView<T> getArray(const Node& node, boost::string_view key)
+{
+  return getArray<T>(at(getBranch(node), key));
+}
+
 /// Traverses and prints a tree, starting at the given node.
 ///
 /// \param node Node to start printing from
@@ -172,7 +861,9 @@ inline void printTree(const Node& node, std::ostream& stream, int level = 0)
             [&](const std::string& value) { stream << "String: " << value; },
             [&](int value) { stream << "Int:    " << value; },
             [&](bool value) { stream << "Bool:   " << value; },
-            [&](double value) { stream << "Double: " << value; });
+            [&](double value) { stream << "Double: " << value; },
+            [&](const DoubleArray& value) { stream << "Double array: " << value; },
+            [&](const IntArray& value) { stream << "Int array: " << value; });
         // Or we could do it like this:
         // stream << convert<std::string>(leaf);
         stream << '\n';
@@ -180,14 +871,145 @@ inline void printTree(const Node& node, std::ostream& stream, int level = 0)
   );
 }
 
+/// Range over the segments of a path (either directories or the name of the key), which are produced on the fly as
+/// boost::string_view into the path. Nothing is copied or allocated, so the path must outlive the range.
+///
+/// The segments are the same as the ones splitPath() returns: leading and trailing separators and spaces are
+/// stripped, and the rest is split on every separator.
+///
+/// Example:
+/// \snippet test/TestTree.cxx [Path segments]
+class PathSegments
+{
+  public:
+    class Iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = boost::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const boost::string_view*;
+        using reference = const boost::string_view&;
+
+        /// Creates an end iterator
+        Iterator() = default;
+
+        const boost::string_view& operator*() const
+        {
+          return mSegment;
+        }
+
+        const boost::string_view* operator->() const
+        {
+          return &mSegment;
+        }
+
+        Iterator& operator++()
+        {
+          advance();
+          return *this;
+        }
+
+        Iterator operator++(int)
+        {
+          Iterator previous = *this;
+          advance();
+          return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+          return mDone == other.mDone && (mDone || mSegment.data() == other.mSegment.data());
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+          return !(*this == other);
+        }
+
+      private:
+        friend class PathSegments;
+
+        Iterator(boost::string_view path, char separator)
+            : mRemaining(path), mSeparator(separator), mHasMore(!path.empty()), mDone(false)
+        {
+          advance();
+        }
+
+        void advance()
+        {
+          if (!mHasMore) {
+            mDone = true;
+            return;
+          }
+          auto position = mRemaining.find(mSeparator);
+          if (position == boost::string_view::npos) {
+            mSegment = mRemaining;
+            mRemaining.clear();
+            mHasMore = false;
+          } else {
+            mSegment = mRemaining.substr(0, position);
+            mRemaining.remove_prefix(position + 1);
+          }
+        }
+
+        boost::string_view mSegment; ///< The current segment
+        boost::string_view mRemaining; ///< The part of the path after the current segment
+        char mSeparator = '/';
+        bool mHasMore = false; ///< True if mRemaining holds at least one more segment
+        bool mDone = true;
+    };
+
+    /// \param path Path to split
+    /// \param separator Separator between the segments
+    explicit PathSegments(boost::string_view path, char separator = '/')
+        : mPath(trim(path, separator)), mSeparator(separator)
+    {
+    }
+
+    Iterator begin() const
+    {
+      return Iterator(mPath, mSeparator);
+    }
+
+    Iterator end() const
+    {
+      return Iterator();
+    }
+
+    /// Returns true if the path has no segments
+    bool empty() const
+    {
+      return mPath.empty();
+    }
+
+  private:
+    static boost::string_view trim(boost::string_view path, char separator)
+    {
+      auto isTrimmed = [separator](char c) { return c == separator || c == ' '; };
+      while (!path.empty() && isTrimmed(path.front())) {
+        path.remove_prefix(1);
+      }
+      while (!path.empty() && isTrimmed(path.back())) {
+        path.remove_suffix(1);
+      }
+      return path;
+    }
+
+    boost::string_view mPath; ///< The path, with leading and trailing separators stripped
+    char mSeparator;
+};
+
 /// Split path into segments (either directories or the name of the key).
 /// For example, turns "/my/path" into a vector of "my" and "path.
+/// Note: this copies every segment. For lookups, iterating over PathSegments is cheaper.
 ///
 /// \param path Path to split
 /// \return Vector of split path segments
-auto splitPath(const std::string& path) -> std::vector<std::string>;
+auto splitPath(boost::string_view path) -> std::vector<std::string>;
 
 /// Gets a subtree based on a path string.
+/// This does not allocate, except for the exception thrown when the path does not exist.
 ///
 /// Example:
 /// \snippet test/Example.cxx [Get subtree]
@@ -195,22 +1017,151 @@ auto splitPath(const std::string& path) -> std::vector<std::string>;
 /// \param node Base node to get subtree from
 /// \param path Path from the base node to the subtree
 /// \return Subtree
-auto getSubtree(const Node& node, const std::string& path) -> const Node&;
+auto getSubtree(const Node& node, boost::string_view path) -> const Node&;
+
+/// Gets a subtree based on a path string, like getSubtree(), but without throwing.
+/// This never allocates, so a path that does not exist costs no more than one that does.
+/// Call it qualified, as Tree::find(), since argument-dependent lookup may also find boost::find().
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Find]
+///
+/// \param node Base node to get subtree from
+/// \param path Path from the base node to the subtree
+/// \return The subtree, or nullptr if the path does not exist or goes through a leaf
+auto find(const Node& node, boost::string_view path) -> const Node*;
+
+/// Gets and converts the value at a path, without throwing
+/// \param node Base node to get the value from
+/// \param path Path from the base node to the value
+/// \return The value, or nothing if the path does not lead to a leaf or the leaf cannot be converted
+template <class T>
+Optional<T> tryGet(const Node& node, boost::string_view path)
+{
+  const Node* found = Tree::find(node, path);
+  if (found == nullptr) {
+    return boost::none;
+  }
+  const auto* leaf = boost::get<Leaf>(found);
+  if (leaf == nullptr) {
+    return boost::none;
+  }
+  return tryConvert<T>(*leaf);
+}
 
 /// Converts key-value pairs into a tree.
+/// The pairs are sorted by path and the tree is built in a single pass. If a key is both a directory in one path and a
+/// value in another, it becomes a branch. If several pairs have the same path, the first one is used.
 ///
 /// Example:
 /// \snippet test/Example.cxx [Key-value pair conversion]
 ///
 /// \param pairs Key value pairs to convert
+/// \param threads Amount of threads to use for sorting and for building the top-level subtrees. Only worth it for
+///   large amounts of pairs.
 /// \return Converted tree
-auto keyValuesToTree(const std::vector<std::pair<std::string, Leaf>>& pairs) -> Node;
+auto keyValuesToTree(const std::vector<std::pair<std::string, Leaf>>& pairs, std::size_t threads = 1) -> Node;
 
-/// Converts a tree into key-value pairs.
+/// Converts a tree into key-value pairs, in depth-first order. Paths have a leading slash, a leaf root gets the path "/".
 ///
 /// \param node Tree to convert
+/// \param threads Amount of threads to use. The top-level subtrees are divided between them, so it is only worth it for
+///   large trees that have several top-level branches.
 /// \return Converted key-value pairs
-auto treeToKeyValues(const Node& node) -> const std::vector<std::pair<std::string, Leaf>>;
+auto treeToKeyValues(const Node& node, std::size_t threads = 1) -> std::vector<std::pair<std::string, Leaf>>;
+
+/// Lazy depth-first range over the leaves of a tree, in the same order as treeToKeyValues(), yielding the path and a
+/// reference to every leaf without materializing them.
+/// The iterator keeps a stack of one entry per level and a single path buffer, so stepping through the tree does not
+/// allocate once the buffer is large enough for the longest path. The path of the current leaf is only valid until
+/// the iterator is incremented.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Leaf range]
+class LeafRange
+{
+  public:
+    /// Input iterator: dereferencing gives a pair by value rather than a reference, and its path points into the
+    /// iterator's own buffer, which incrementing overwrites
+    class Iterator
+    {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<boost::string_view, const Leaf&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        /// Creates an end iterator
+        Iterator() = default;
+
+        value_type operator*() const
+        {
+          return value_type(mPath, *mLeaf);
+        }
+
+        Iterator& operator++()
+        {
+          advance();
+          return *this;
+        }
+
+        Iterator operator++(int)
+        {
+          Iterator previous = *this;
+          advance();
+          return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+          return mLeaf == other.mLeaf;
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+          return !(*this == other);
+        }
+
+      private:
+        friend class LeafRange;
+
+        explicit Iterator(const Node& node);
+
+        /// Moves to the next leaf, or to the end
+        void advance();
+
+        /// A branch being iterated over
+        struct Frame
+        {
+            Branch::const_iterator next; ///< The next child to visit
+            Branch::const_iterator end;
+            std::size_t pathSize; ///< Length of the path of the branch itself
+        };
+
+        std::vector<Frame> mStack;
+        std::string mPath; ///< Path of the current leaf
+        const Leaf* mLeaf = nullptr; ///< The current leaf, nullptr at the end
+    };
+
+    /// \param node Tree to iterate over. It must outlive the range and must not be modified while iterating.
+    explicit LeafRange(const Node& node) : mNode(node)
+    {
+    }
+
+    Iterator begin() const
+    {
+      return Iterator(mNode);
+    }
+
+    Iterator end() const
+    {
+      return Iterator();
+    }
+
+  private:
+    const Node& mNode;
+};
 
 
 } // namespace Tree
@@ -0,0 +1,358 @@
+/// \file TreeBind.h
+/// \brief Binding of trees to C++ structs, based on compile-time field descriptors
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEBIND_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEBIND_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Describes how a member of a struct is bound to a key of a branch. See field() and optionalField().
+template <class Struct, class Member>
+struct Field
+{
+    using Type = Member;
+
+    boost::string_view key;
+    Member Struct::* member;
+    bool required;
+};
+
+/// Describes a field bound to the given key. The field is required, unless the member is an Optional.
+/// The key must outlive the binding, which string literals do.
+template <class Struct, class Member>
+Field<Struct, Member> field(boost::string_view key, Member Struct::* member)
+{
+  return {key, member, true};
+}
+
+template <class Struct, class Member>
+Field<Struct, Optional<Member>> field(boost::string_view key, Optional<Member> Struct::* member)
+{
+  return {key, member, false};
+}
+
+/// Describes a field bound to the given key, which keeps its initial value when the key is missing
+template <class Struct, class Member>
+Field<Struct, Member> optionalField(boost::string_view key, Member Struct::* member)
+{
+  return {key, member, false};
+}
+
+/// Groups the field descriptors of a struct
+template <class... Fields>
+std::tuple<Fields...> fields(Fields... descriptors)
+{
+  return std::tuple<Fields...>(descriptors...);
+}
+
+namespace BindImplementation
+{
+template <class...>
+struct MakeVoid
+{
+    using type = void;
+};
+
+template <class... T>
+using VoidT = typename MakeVoid<T...>::type;
+} // namespace BindImplementation
+
+/// Gives the field descriptors of a bindable struct.
+/// By default, they come from a static member function treeFields() of the struct. For structs that cannot be
+/// modified, this can be specialised with a static member function get() returning the descriptors instead.
+template <class T, class = void>
+struct Fields
+{
+};
+
+template <class T>
+struct Fields<T, BindImplementation::VoidT<decltype(T::treeFields())>>
+{
+    static auto get() -> decltype(T::treeFields())
+    {
+      return T::treeFields();
+    }
+};
+
+/// True if T has field descriptors, so it can be used with bind()
+template <class T, class = void>
+struct IsBindable : std::false_type
+{
+};
+
+template <class T>
+struct IsBindable<T, BindImplementation::VoidT<decltype(Fields<T>::get())>> : std::true_type
+{
+};
+
+/// A field that could not be bound
+struct BindFailure
+{
+    /// Path of the field, with a leading slash like treeToKeyValues() produces. The root is "/".
+    std::string path;
+
+    /// What went wrong
+    std::string reason;
+};
+
+/// Thrown by bind() when fields could not be bound. It lists every failure, not only the first one.
+class BindError : public std::runtime_error
+{
+  public:
+    explicit BindError(std::vector<BindFailure> failures);
+
+    const std::vector<BindFailure>& failures() const
+    {
+      return mFailures;
+    }
+
+  private:
+    std::vector<BindFailure> mFailures;
+};
+
+namespace BindImplementation
+{
+/// Keeps track of the current path and collects the failures while binding
+class Context
+{
+  public:
+    void push(boost::string_view key)
+    {
+      mPath.push_back(key);
+    }
+
+    void pop()
+    {
+      mPath.pop_back();
+    }
+
+    /// Records a failure of the field at the current path
+    void fail(std::string reason);
+
+    /// Records a missing field, which is a child of the current path
+    void failMissing(boost::string_view key);
+
+    /// Records a leaf that could not be converted to the type of the field at the current path
+    void failConversion(const Leaf& leaf);
+
+    /// \throw BindError if any failures were recorded
+    void throwIfFailed();
+
+  private:
+    /// Keys of the current path. They point into the tree or the field descriptors, so they are only joined when a
+    /// failure is recorded.
+    std::vector<boost::string_view> mPath;
+    std::vector<BindFailure> mFailures;
+};
+
+template <class Struct>
+void bindStruct(const Node& node, Struct& object, Context& context);
+
+/// Reads a leaf value into a member, converting it with Tree::convert() (which does not convert a leaf that is already
+/// of the member's type)
+template <class T, class = void>
+struct Reader
+{
+    static void read(const Node& node, T& value, Context& context)
+    {
+      const auto* leaf = boost::get<Leaf>(&node);
+      if (leaf == nullptr) {
+        context.fail("expected a value, found a branch");
+        return;
+      }
+      try {
+        value = convert<T>(*leaf);
+      }
+      catch (const boost::bad_lexical_cast&) {
+        context.failConversion(*leaf);
+      }
+    }
+};
+
+/// Reads an optional member
+template <class T>
+struct Reader<Optional<T>>
+{
+    static void read(const Node& node, Optional<T>& value, Context& context)
+    {
+      value.emplace();
+      Reader<T>::read(node, *value, context);
+    }
+};
+
+/// Reads an array member. Integer arrays are also accepted for double arrays, since JSON does not tell them apart.
+template <class T>
+struct Reader<Array<T>>
+{
+    static void read(const Node& node, Array<T>& value, Context& context)
+    {
+      const auto* leaf = boost::get<Leaf>(&node);
+      if (leaf == nullptr) {
+        context.fail("expected an array, found a branch");
+        return;
+      }
+      if (const auto* exact = leaf->getIf<Array<T>>()) {
+        value = *exact;
+        return;
+      }
+      const auto* integers = leaf->getIf<IntArray>();
+      if (std::is_same<T, double>::value && integers != nullptr) {
+        value = Array<T>(integers->begin(), integers->end());
+        return;
+      }
+      context.failConversion(*leaf);
+    }
+};
+
+/// Copies the subtree as it is, for parts of the tree that have no fixed layout
+template <>
+struct Reader<Node>
+{
+    static void read(const Node& node, Node& value, Context&)
+    {
+      value = node;
+    }
+};
+
+/// Reads a nested bindable struct
+template <class T>
+struct Reader<T, typename std::enable_if<IsBindable<T>::value>::type>
+{
+    static void read(const Node& node, T& value, Context& context)
+    {
+      bindStruct(node, value, context);
+    }
+};
+
+/// Field of a struct, with the type of its member erased
+template <class Struct>
+struct FieldEntry
+{
+    boost::string_view key;
+    bool required;
+    void (*read)(const Node& node, Struct& object, Context& context);
+};
+
+/// The fields of a struct sorted by key, built once per struct type
+template <class Struct>
+class FieldTable
+{
+  public:
+    static const std::vector<FieldEntry<Struct>>& get()
+    {
+      static const std::vector<FieldEntry<Struct>> table = make(
+          std::make_index_sequence<std::tuple_size<Descriptors>::value>());
+      return table;
+    }
+
+  private:
+    using Descriptors = decltype(Fields<Struct>::get());
+
+    static const Descriptors& descriptors()
+    {
+      static const Descriptors descriptors = Fields<Struct>::get();
+      return descriptors;
+    }
+
+    template <std::size_t I>
+    static void readField(const Node& node, Struct& object, Context& context)
+    {
+      using Member = typename std::tuple_element<I, Descriptors>::type::Type;
+      Reader<Member>::read(node, object.*(std::get<I>(descriptors()).member), context);
+    }
+
+    template <std::size_t... I>
+    static std::vector<FieldEntry<Struct>> make(std::index_sequence<I...>)
+    {
+      std::vector<FieldEntry<Struct>> table {
+          FieldEntry<Struct> {std::get<I>(descriptors()).key, std::get<I>(descriptors()).required, &readField<I>}...};
+      std::sort(table.begin(), table.end(), [](const FieldEntry<Struct>& a, const FieldEntry<Struct>& b) {
+        return a.key < b.key;
+      });
+      return table;
+    }
+};
+
+/// Binds the children of a branch to the fields of a struct. Since both the branch and the field table are sorted by
+/// key, this is a single merge-walk over the two, rather than one lookup per field.
+template <class Struct>
+void bindStruct(const Node& node, Struct& object, Context& context)
+{
+  const auto* branch = boost::get<Branch>(&node);
+  if (branch == nullptr) {
+    context.fail("expected a branch, found a value");
+    return;
+  }
+
+  auto iter = branch->begin();
+  auto end = branch->end();
+  for (const auto& entry : FieldTable<Struct>::get()) {
+    int comparison = 1;
+    while (iter != end && (comparison = boost::string_view(iter->first).compare(entry.key)) < 0) {
+      ++iter;
+    }
+    if (iter != end && comparison == 0) {
+      context.push(entry.key);
+      entry.read(iter->second, object, context);
+      context.pop();
+    } else if (entry.required) {
+      context.failMissing(entry.key);
+    }
+  }
+}
+} // namespace BindImplementation
+
+/// Fills a struct from a branch, according to the struct's field descriptors (see Fields).
+/// Children of the branch that do not correspond to a field are ignored. Fields can be:
+///   * leaf types, which are converted like Tree::convert() does when the leaf holds another type
+///   * Optional, for fields that may be missing
+///   * Array, where an IntArray is also accepted for a DoubleArray
+///   * Node, to take a subtree as it is
+///   * other bindable structs, for nested branches
+/// Fields that are missing or cannot be converted keep the value they had.
+/// \throw BindError listing all required fields that are missing and all fields that could not be converted
+template <class T>
+void bindInto(const Node& node, T& object)
+{
+  static_assert(IsBindable<T>::value, "Type needs field descriptors to be bound, see Tree::Fields");
+  BindImplementation::Context context;
+  BindImplementation::bindStruct(node, object, context);
+  context.throwIfFailed();
+}
+
+/// Creates a struct and fills it from a branch, see bindInto().
+/// Call it qualified, as Tree::bind(), since argument-dependent lookup also finds std::bind() for a Node.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Bind]
+template <class T>
+T bind(const Node& node)
+{
+  T object {};
+  bindInto(node, object);
+  return object;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEBIND_H_ */
@@ -0,0 +1,71 @@
+/// \file TreeDiff.h
+/// \brief Computing and applying the differences between two trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEDIFF_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEDIFF_H_
+
+#include <string>
+#include <vector>
+#include "Configuration/Tree.h"
+#include "Configuration/TreeHash.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// A single difference between two trees
+struct Change
+{
+    enum class Operation
+    {
+      Added, ///< The path only exists in the new tree. The value is the added subtree.
+      Removed, ///< The path only exists in the old tree. The value is the removed subtree.
+      Changed, ///< The path is a leaf in both trees, with different values. The value is the new leaf.
+      TypeChanged ///< The path is a leaf in one tree and a branch in the other. The value is the new subtree.
+    };
+
+    Operation operation;
+
+    /// Keys from the root to the changed node. The root itself has no keys. The keys are kept apart rather than joined,
+    /// so keys containing '/', empty keys and keys with spaces are applied as they are.
+    std::vector<std::string> path;
+
+    /// See Operation
+    Node value;
+
+    /// Joins the path with slashes, with a leading slash like treeToKeyValues() produces. The root is "/".
+    std::string pathString() const;
+};
+
+/// List of changes, sorted by path
+using Delta = std::vector<Change>;
+
+/// Computes the changes that turn tree 'a' into tree 'b'.
+/// The delta is minimal: an added or removed subtree is a single change, not one per leaf. Subtrees that are the same
+/// object in both trees (for example when they are shared through a SharedNode) are skipped without being walked.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Diff]
+auto diff(const Node& a, const Node& b) -> Delta;
+
+/// Like diff(const Node&, const Node&), but subtrees with equal hashes are taken to be equal and skipped without being
+/// walked. Useful when the same trees are compared repeatedly, or when they are mostly equal.
+/// The hashes are not cryptographic: a change whose subtree collides with the old one, with a chance of about 2^-64 per
+/// subtree, is missed. Use diff(const Node&, const Node&) where that is not acceptable.
+auto diff(HashCache& a, HashCache& b) -> Delta;
+
+/// Applies the changes of a delta to a tree, in place. Applying diff(a, b) to 'a' turns it into 'b'.
+/// Branches on the path of an added subtree are created if they do not exist.
+/// \throw std::out_of_range if a removed path does not exist, or a path goes through a leaf
+void applyDelta(Node& node, const Delta& delta);
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEDIFF_H_ */
@@ -0,0 +1,100 @@
+/// \file TreeHash.h
+/// \brief Content hashing of trees, for cheap equality and change detection
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEHASH_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEHASH_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Content hash of a tree.
+/// The hash of a leaf depends on its type and value. The hash of a branch is computed from the keys and hashes of its
+/// children, in key order (like a Merkle tree), so equal trees have equal hashes and a change anywhere in a subtree
+/// changes the hash of every branch above it.
+/// Hashes are not stable across versions of this library, so they should not be persisted.
+using Hash = std::uint64_t;
+
+/// Computes the hash of a leaf
+auto hash(const Leaf& leaf) -> Hash;
+
+/// Computes the hash of a tree. This walks the whole tree, see HashCache to avoid doing that repeatedly.
+auto hash(const Node& node) -> Hash;
+
+/// Computes the hash of the subtree at the given path. See Tree::getSubtree().
+auto getHash(const Node& node, boost::string_view path) -> Hash;
+
+/// Building blocks for computing branch hashes incrementally, for tree representations other than Node
+namespace HashImplementation
+{
+/// Hashes a sequence of bytes
+auto hashBytes(const void* data, std::size_t size) -> Hash;
+
+/// Initial hash of a branch, before any children are added
+auto branchSeed() -> Hash;
+
+/// Adds a child to the hash of a branch. Children must be added in key order.
+auto addChild(Hash branch, boost::string_view key, Hash child) -> Hash;
+} // namespace HashImplementation
+
+/// Memoizes the hashes of the branches of a tree, so every subtree is hashed at most once.
+/// Hashes are computed lazily, when first asked for, and are then one lookup away. The tree must not be modified
+/// while it is being used with a cache.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [HashCache]
+class HashCache
+{
+  public:
+    /// \param root The tree to hash
+    explicit HashCache(const Node& root) : mRoot(root)
+    {
+    }
+
+    /// Gets the hash of the tree
+    auto hash() -> Hash
+    {
+      return hash(mRoot);
+    }
+
+    /// Gets the hash of the subtree at the given path. See Tree::getSubtree().
+    auto getHash(boost::string_view path) -> Hash
+    {
+      return hash(getSubtree(mRoot, path));
+    }
+
+    /// Gets the hash of a node, which must be part of this cache's tree
+    auto hash(const Node& node) -> Hash;
+
+    /// The tree this cache hashes
+    const Node& root() const
+    {
+      return mRoot;
+    }
+
+    /// Removes all memoized hashes, for example after the tree has been modified
+    void clear()
+    {
+      mHashes.clear();
+    }
+
+  private:
+    const Node& mRoot;
+    std::unordered_map<const Node*, Hash> mHashes;
+};
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEHASH_H_ */
@@ -0,0 +1,108 @@
+/// \file TreeOverlay.h
+/// \brief Definition of the Overlay, a merged view of a stack of trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEOVERLAY_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEOVERLAY_H_
+
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Read-only view of a stack of trees, as if every layer was merged over the ones below it, without copying anything.
+///
+/// The layers are searched top-down on every lookup, so adding a layer costs nothing up front. The merge rules are the
+/// same as for applying the layers one after the other, bottom first:
+///   * where several layers have a leaf at the same path, the topmost one wins
+///   * a leaf hides everything below it in lower layers, and a branch hides leaves at the same path in lower layers
+///   * branches at the same path are merged
+///
+/// The Overlay only refers to the layers, so they must outlive it and must not be modified while it is in use.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Overlay]
+class Overlay
+{
+  public:
+    /// Creates an overlay without layers, equivalent to an empty branch
+    Overlay() = default;
+
+    /// \param layers The layers, bottom first
+    Overlay(std::initializer_list<std::reference_wrapper<const Node>> layers);
+
+    /// Adds a layer on top of the others
+    void push(const Node& layer)
+    {
+      mLayers.push_back(&layer);
+    }
+
+    /// Removes the top layer
+    void pop()
+    {
+      mLayers.pop_back();
+    }
+
+    /// Amount of layers
+    std::size_t size() const
+    {
+      return mLayers.size();
+    }
+
+    /// Returns true if there is a node at the given path
+    bool exists(boost::string_view path) const
+    {
+      return find(path) != nullptr;
+    }
+
+    /// Returns true if the merged node is a leaf
+    bool isLeaf() const
+    {
+      return !mLayers.empty() && boost::get<Leaf>(mLayers.back()) != nullptr;
+    }
+
+    /// Gets and converts the leaf at the given path, searching the layers top-down
+    /// \return The converted value, or none if there is no leaf at the path
+    template <class T>
+    Optional<T> get(boost::string_view path) const
+    {
+      if (const auto* node = find(path)) {
+        return Tree::get<T>(*node);
+      }
+      return boost::none;
+    }
+
+    /// Gets a view of the subtree at the given path. It contains the subtrees at that path of every layer that is not
+    /// hidden by another.
+    /// \throw std::out_of_range if the path does not exist in any layer
+    auto getSubtree(boost::string_view path) const -> Overlay;
+
+    /// Keys of the children of the merged node, sorted. Empty if the merged node is a leaf.
+    auto keys() const -> std::vector<std::string>;
+
+    /// Merges the layers into a single tree. This copies everything that is visible, so should be used sparingly.
+    auto flatten() const -> Node;
+
+  private:
+    /// Finds the node the merged tree would have at the given path, or nullptr if there is none
+    auto find(boost::string_view path) const -> const Node*;
+
+    /// The layers, bottom first
+    std::vector<const Node*> mLayers;
+};
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEOVERLAY_H_ */
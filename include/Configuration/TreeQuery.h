@@ -0,0 +1,79 @@
+/// \file TreeQuery.h
+/// \brief Wildcard path queries over trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEQUERY_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEQUERY_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// A node found by a query
+struct Match
+{
+    /// Path of the node, with a leading slash like treeToKeyValues() produces. The root is "/".
+    std::string path;
+
+    /// The node, which is a leaf or a branch depending on what the pattern selects
+    const Node* node;
+};
+
+/// Compiled wildcard path pattern.
+///
+/// The pattern is split into segments like any other path. Within a segment, '*' matches any amount of characters and
+/// '?' matches exactly one, but neither matches across a '/'. So "/equipment_*/enabled" matches "/equipment_1/enabled"
+/// but not "/equipment_1/links/enabled".
+///
+/// Parsing happens once, in the constructor, so a Query can be kept around and evaluated repeatedly for free.
+/// Evaluation is a single traversal that only descends into branches matching the pattern: a segment without
+/// wildcards is a direct lookup, and one with wildcards only scans the keys starting with its literal prefix.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Query]
+class Query
+{
+  public:
+    /// Function called for every match, with the path of the match and the matching node. The path is only valid
+    /// during the call.
+    using Callback = std::function<void(boost::string_view path, const Node& node)>;
+
+    /// \param pattern Path pattern, see the class description
+    explicit Query(boost::string_view pattern);
+
+    /// Calls the callback for every node matching the pattern, in depth-first key order
+    void forEach(const Node& node, const Callback& callback) const;
+
+    /// Collects all nodes matching the pattern, in depth-first key order
+    auto match(const Node& node) const -> std::vector<Match>;
+
+  private:
+    struct Segment
+    {
+        std::string pattern;
+        std::size_t literalPrefix; ///< Length of the part of the pattern before the first wildcard
+    };
+
+    void visit(const Node& node, std::size_t depth, std::string& path, const Callback& callback) const;
+
+    std::vector<Segment> mSegments;
+};
+
+/// Shorthand for Query(pattern).match(node). Prefer keeping a Query around when using the same pattern repeatedly.
+auto query(const Node& node, boost::string_view pattern) -> std::vector<Match>;
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEQUERY_H_ */
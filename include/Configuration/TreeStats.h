@@ -0,0 +1,75 @@
+/// \file TreeStats.h
+/// \brief Shape statistics and memory accounting of trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREESTATS_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREESTATS_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Shape and size of a tree, see stats()
+struct Stats
+{
+    /// Amount of leaves of each type
+    struct LeafCounts
+    {
+        std::size_t strings = 0;
+        std::size_t ints = 0;
+        std::size_t doubles = 0;
+        std::size_t bools = 0;
+        std::size_t doubleArrays = 0;
+        std::size_t intArrays = 0;
+    };
+
+    /// Amount of nodes, branches and leaves, including the root
+    std::size_t nodes = 0;
+    std::size_t branches = 0;
+    std::size_t leaves = 0;
+    LeafCounts leafTypes;
+
+    /// Depth of the deepest node. The root has depth 0, its children depth 1, and so on.
+    std::size_t maxDepth = 0;
+
+    /// Histogram of the amount of children of the branches: amount of children -> amount of branches with that many
+    std::map<std::size_t, std::size_t> fanout;
+
+    /// Estimated heap bytes of the tree, see heapBytes()
+    std::size_t heapBytes = 0;
+
+    /// Estimated heap bytes of each child of the root, to find out which parts of a tree are large
+    std::map<std::string, std::size_t> childHeapBytes;
+};
+
+/// Estimates the heap bytes used by a tree: the branch containers and their entries, and the contents of strings and
+/// arrays that do not fit inline. The Node itself is not included, since it may live on the stack or inside another
+/// container. The estimate follows the layout of the containers, but not the overhead of the allocator.
+auto heapBytes(const Node& node) -> std::size_t;
+
+/// Estimates the heap bytes used by a leaf, not including the Leaf itself
+auto heapBytes(const Leaf& leaf) -> std::size_t;
+
+/// Heap bytes used by the contents of a string, or 0 if the string stores them inline
+auto heapBytes(const std::string& string) -> std::size_t;
+
+/// Gathers statistics on the shape and memory usage of a tree in one walk over it
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Stats]
+auto stats(const Node& node) -> Stats;
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREESTATS_H_ */
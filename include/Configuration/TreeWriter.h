@@ -0,0 +1,58 @@
+/// \file TreeWriter.h
+/// \brief Serialization of trees to JSON and INI
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEWRITER_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEWRITER_H_
+
+#include <ostream>
+#include <string>
+#include "Configuration/Tree.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+
+/// Writes a tree as JSON.
+/// Branches become objects and leaves become strings, numbers, booleans or arrays of numbers. Doubles are written with enough digits to
+/// read back the same value, and always with a decimal point or exponent so they are not read back as integers.
+/// Output goes through a large internal buffer, so the stream sees few, large writes.
+///
+/// Example:
+///   \snippet test/TestTree.cxx [Writers]
+///
+/// \param node Tree to write
+/// \param stream Stream to write to
+/// \param pretty Put every member on its own line, indented by nesting depth. Otherwise, the output has no whitespace.
+/// \throw std::runtime_error if the tree contains a NaN or infinite double, which JSON cannot represent. Large documents
+///   are written in blocks of 64 KiB as they are produced, so the blocks before the error may have been written.
+void writeJson(const Node& node, std::ostream& stream, bool pretty = false);
+
+/// Like writeJson(), but returns the JSON as a string
+auto toJson(const Node& node, bool pretty = false) -> std::string;
+
+/// Writes a tree in the INI format used by the file backend.
+/// Leaves directly under the root come first, without a section. Every other branch with leaves gets a section named
+/// after its path, with '/' between the keys. Numbers are written like writeJson() does, booleans as 1 or 0 so they
+/// convert back with Tree::convert<bool>(), and arrays as their elements separated by commas.
+/// The INI format only has one level of sections, so only trees up to two levels deep read back the same.
+///
+/// \param node Tree to write
+/// \param stream Stream to write to
+/// \param pretty Put spaces around the '=' of every key-value pair
+/// \throw std::runtime_error if a key or value cannot be represented in INI, for example because it has a newline. As
+///   with writeJson(), the blocks written before the error are kept.
+void writeIni(const Node& node, std::ostream& stream, bool pretty = false);
+
+/// Like writeIni(), but returns the INI as a string
+auto toIni(const Node& node, bool pretty = false) -> std::string;
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_TREEWRITER_H_ */
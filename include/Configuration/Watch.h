@@ -0,0 +1,54 @@
+/// \file Watch.h
+/// \brief Subscriptions to changes of configuration values
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_WATCH_H_
+#define ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_WATCH_H_
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/core/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+
+/// A value that changed under a watched prefix
+struct KeyChange
+{
+    /// Path of the value, relative to the watched prefix like the keys of ConfigurationInterface::getRecursiveMap()
+    std::string path;
+
+    /// The new value, or nothing if the value was deleted
+    boost::optional<std::string> value;
+};
+
+/// Receives the values that changed, sorted by path. It is called on a thread of the watch, one call at a time. It
+/// should not throw, but if it does, the watch keeps going and keeps the exception, see Watch::callbackError().
+using WatchCallback = std::function<void(const std::vector<KeyChange>& changes)>;
+
+/// Handle of a subscription made with ConfigurationInterface::watch(). Destroying it cancels the subscription.
+class Watch : public boost::noncopyable
+{
+  public:
+    virtual ~Watch();
+
+    /// Stops the subscription. When it returns, the callback is not running and will not be called again, so it must
+    /// not be called from the callback itself.
+    virtual void cancel() = 0;
+
+    /// Gets the last exception thrown by the callback. The default implementation is for watches that do not catch
+    /// them, and returns nullptr.
+    /// \return The exception, or nullptr if the callback has not thrown
+    virtual std::exception_ptr callbackError() const;
+};
+
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif /* ALICEO2_CONFIGURATION_INCLUDE_CONFIGURATION_WATCH_H_ */
@@ -6,8 +6,14 @@
 #ifndef ALICEO2_CONFIGURATION_SRC_BACKENDBASE_H_
 #define ALICEO2_CONFIGURATION_SRC_BACKENDBASE_H_
 
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
 #include <boost/core/noncopyable.hpp>
+#include <boost/utility/string_view.hpp>
 #include "Configuration/ConfigurationInterface.h"
+#include "Configuration/TreeStats.h"
 
 namespace AliceO2 {
 namespace Configuration {
@@ -42,6 +48,75 @@ class BackendBase: public ConfigurationInterface, public boost::noncopyable
       throw std::runtime_error("getRecursiveMap() unsupported by backend");
     }
 
+  protected:
+    /// Resolves a batch of paths in a single traversal of a tree. The paths are visited in sorted order, so that
+    /// consecutive paths share their leading segments, and only the segments after those are looked up.
+    /// \param root The root of the tree
+    /// \param paths The paths to resolve, split into segments like Tree::PathSegments does
+    /// \param separator The separator between the segments of the paths
+    /// \param findChild Function (const NodeType& node, boost::string_view key) -> const NodeType*, giving the child
+    ///   of the node with the given key, or nullptr if there is none
+    /// \return The nodes the paths resolved to, in the order of the paths, or nullptr for paths that do not exist
+    template <class NodeType, class FindChild>
+    static std::vector<const NodeType*> findSorted(const NodeType& root, const std::vector<std::string>& paths,
+        char separator, FindChild findChild)
+    {
+      auto splitPath = [separator](boost::string_view path, std::vector<boost::string_view>& segments) {
+        for (const auto& segment : Tree::PathSegments(path, separator)) {
+          segments.push_back(segment);
+        }
+      };
+      return findSortedSplit(root, paths, splitPath, findChild);
+    }
+
+    /// Like findSorted(), for backends that split paths differently than Tree::PathSegments
+    /// \param splitPath Function (boost::string_view path, std::vector<boost::string_view>& segments), appending the
+    ///   segments of the path
+    template <class NodeType, class SplitPath, class FindChild>
+    static std::vector<const NodeType*> findSortedSplit(const NodeType& root, const std::vector<std::string>& paths,
+        SplitPath splitPath, FindChild findChild)
+    {
+      std::vector<std::size_t> order(paths.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return paths[a] < paths[b]; });
+
+      std::vector<const NodeType*> results(paths.size(), nullptr);
+      std::vector<boost::string_view> previous; // Segments of the previous path
+      std::vector<boost::string_view> current;
+      std::vector<const NodeType*> nodes {&root}; // nodes[i] is the node at the first i segments of the previous path
+      for (auto index : order) {
+        current.clear();
+        splitPath(paths[index], current);
+
+        std::size_t shared = 0;
+        while (shared < current.size() && shared < previous.size() && current[shared] == previous[shared]) {
+          ++shared;
+        }
+        nodes.resize(shared + 1);
+        for (std::size_t i = shared; i < current.size(); ++i) {
+          const NodeType* parent = nodes.back();
+          nodes.push_back(parent == nullptr ? nullptr : findChild(*parent, current[i]));
+        }
+
+        results[index] = nodes.back();
+        std::swap(previous, current);
+      }
+      return results;
+    }
+
+    /// Estimates the heap bytes of a cache keyed by precompiled paths, not including heap memory owned by the values
+    template <class Cache>
+    static std::size_t pathCacheBytes(const Cache& cache)
+    {
+      // Every element is a separately allocated node holding a link, the element and its hash
+      std::size_t bytes = cache.bucket_count() * sizeof(void*);
+      for (const auto& keyValuePair : cache) {
+        bytes += sizeof(void*) + sizeof(keyValuePair) + sizeof(std::size_t);
+        bytes += Tree::heapBytes(keyValuePair.first.string());
+      }
+      return bytes;
+    }
+
   private:
     /// Default separator for keys/paths
     static constexpr char DEFAULT_SEPARATOR = '/';
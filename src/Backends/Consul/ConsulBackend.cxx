@@ -4,6 +4,16 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "ConsulBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "Configuration/TreeWriter.h"
 
 namespace AliceO2
 {
@@ -28,10 +38,259 @@ auto stripRequestKey(const std::string& requestKey, const std::string& response)
   assert(response.find(requestKey) == 0);
   return response.substr(requestKey.length());
 }
+
+/// Maximum amount of operations in a Consul transaction
+constexpr std::size_t TRANSACTION_MAX_OPERATIONS = 64;
+
+auto base64(boost::string_view data) -> std::string
+{
+  static constexpr char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  encoded.reserve((data.size() + 2) / 3 * 4);
+  std::size_t i = 0;
+  for (; i + 2 < data.size(); i += 3) {
+    auto bits = (std::uint32_t(std::uint8_t(data[i])) << 16) | (std::uint32_t(std::uint8_t(data[i + 1])) << 8)
+        | std::uint32_t(std::uint8_t(data[i + 2]));
+    encoded.push_back(ALPHABET[(bits >> 18) & 0x3f]);
+    encoded.push_back(ALPHABET[(bits >> 12) & 0x3f]);
+    encoded.push_back(ALPHABET[(bits >> 6) & 0x3f]);
+    encoded.push_back(ALPHABET[bits & 0x3f]);
+  }
+  if (i < data.size()) {
+    auto bits = std::uint32_t(std::uint8_t(data[i])) << 16;
+    if (i + 1 < data.size()) {
+      bits |= std::uint32_t(std::uint8_t(data[i + 1])) << 8;
+    }
+    encoded.push_back(ALPHABET[(bits >> 18) & 0x3f]);
+    encoded.push_back(ALPHABET[(bits >> 12) & 0x3f]);
+    encoded.push_back(i + 1 < data.size() ? ALPHABET[(bits >> 6) & 0x3f] : '=');
+    encoded.push_back('=');
+  }
+  return encoded;
+}
+
+/// Makes the body of a Consul transaction that sets the given keys to the given values
+template <class Iterator>
+auto makeTransaction(Iterator begin, Iterator end) -> std::string
+{
+  using namespace std::literals::string_literals;
+  std::string body = "[";
+  for (auto iter = begin; iter != end; ++iter) {
+    if (iter != begin) {
+      body.push_back(',');
+    }
+    // Consul takes the values base64-encoded
+    body += Tree::toJson(Tree::Branch {{"KV", Tree::Branch {
+        {"Verb", "set"s},
+        {"Key", iter->first},
+        {"Value", base64(iter->second)}}}});
+  }
+  body.push_back(']');
+  return body;
+}
+
+auto getItem(ppconsul::kv::Storage& storage, const std::string& key) -> boost::optional<std::string>
+{
+  auto item = storage.item(key, ppconsul::keywords::consistency = ppconsul::Consistency::Stale);
+  if (item.valid()) {
+    return std::move(item.value);
+  } else {
+    return {};
+  }
+}
+
+auto getItems(ppconsul::kv::Storage& storage, const std::string& requestKey) -> std::vector<ppconsul::kv::KeyValue>
+{
+  return storage.items(requestKey, ppconsul::keywords::consistency = ppconsul::Consistency::Stale);
+}
+
+auto getTree(ppconsul::kv::Storage& storage, const std::string& requestKey) -> Tree::Node
+{
+  auto items = getItems(storage, requestKey);
+  std::vector<std::pair<std::string, Tree::Leaf>> keyValuePairs;
+  keyValuePairs.reserve(items.size());
+  for (auto& item : items) {
+    keyValuePairs.emplace_back(stripRequestKey(requestKey, item.key), std::move(item.value));
+  }
+  return Tree::keyValuesToTree(keyValuePairs);
+}
+
+/// How long a blocking query of a watch waits for a change. Consul recommends minutes, so that watches that see no
+/// changes cost almost nothing. Cancelling does not wait for the query.
+constexpr std::chrono::milliseconds WATCH_WAIT = std::chrono::minutes(5);
+
+/// Bounds of the delay before a watch reconnects after a failure, which doubles with every failure in a row
+constexpr std::chrono::milliseconds WATCH_BACKOFF_MIN = std::chrono::milliseconds(100);
+constexpr std::chrono::milliseconds WATCH_BACKOFF_MAX = std::chrono::seconds(30);
+
+/// Length of the longest common prefix of two strings
+auto commonPrefixLength(boost::string_view a, boost::string_view b) -> std::size_t
+{
+  auto mismatch = std::mismatch(a.begin(), a.begin() + std::min(a.size(), b.size()), b.begin());
+  return std::size_t(mismatch.first - a.begin());
+}
 } // Anonymous namespace
 
-ConsulBackend::ConsulBackend(const std::string& host, int port) : mHost(host), mPort(port),
-    mConsul(host + ":" + std::to_string(port)), mStorage(mConsul)
+/// Watch running blocking queries on a thread of its own.
+/// A blocking query cannot be interrupted, so cancelling does not join the thread. It only waits for a callback that is
+/// running, and the detached thread exits when its query returns, ignoring the result. The thread shares the state of
+/// the watch, so the state lives until then.
+class ConsulBackend::ConsulWatch final : public Watch
+{
+  public:
+    /// Reads the initial values on the calling thread, so a failure is reported to the caller, then starts the thread
+    ConsulWatch(ppconsul::kv::Storage& storage, std::string address, std::string requestKey, WatchCallback callback)
+        : mState(std::make_shared<State>(std::move(address), std::move(requestKey), std::move(callback)))
+    {
+      auto response = storage.items(ppconsul::withHeaders, mState->requestKey);
+      mState->updateIndex(response.headers().index());
+      mState->findChanges(response.data());
+      std::thread([state = mState] { state->run(); }).detach();
+    }
+
+    virtual ~ConsulWatch()
+    {
+      cancel();
+    }
+
+    virtual void cancel() override
+    {
+      std::unique_lock<std::mutex> lock(mState->mutex);
+      mState->cancelled = true;
+      mState->condition.notify_all();
+      mState->condition.wait(lock, [this] { return !mState->calling; });
+      // Releasing the callback here rather than on the thread, which may only see the cancellation much later
+      mState->callback = nullptr;
+    }
+
+    virtual std::exception_ptr callbackError() const override
+    {
+      std::lock_guard<std::mutex> lock(mState->mutex);
+      return mState->callbackError;
+    }
+
+  private:
+    struct State
+    {
+        State(std::string address, std::string requestKey, WatchCallback callback)
+            : address(std::move(address)), requestKey(std::move(requestKey)), callback(std::move(callback))
+        {
+        }
+
+        void run()
+        {
+          std::unique_ptr<Connection> connection;
+          auto backoff = WATCH_BACKOFF_MIN;
+          std::mt19937 random(std::random_device {}());
+          while (!isCancelled()) {
+            std::vector<KeyChange> changes;
+            try {
+              if (!connection) {
+                connection = std::make_unique<Connection>(address);
+              }
+              auto response = connection->storage.items(ppconsul::withHeaders, requestKey,
+                  ppconsul::keywords::block_for = std::make_pair(WATCH_WAIT, index));
+              updateIndex(response.headers().index());
+              changes = findChanges(response.data());
+              backoff = WATCH_BACKOFF_MIN;
+            }
+            catch (...) {
+              // Reconnecting after a random part of the backoff, so that many clients do not reconnect all at once
+              connection.reset();
+              std::uniform_int_distribution<std::chrono::milliseconds::rep> distribution(backoff.count() / 2,
+                  backoff.count());
+              std::unique_lock<std::mutex> lock(mutex);
+              condition.wait_for(lock, std::chrono::milliseconds(distribution(random)), [this] { return cancelled; });
+              backoff = std::min(backoff * 2, WATCH_BACKOFF_MAX);
+              continue;
+            }
+
+            if (!changes.empty()) {
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (cancelled) {
+                  break;
+                }
+                calling = true;
+              }
+              std::exception_ptr error;
+              try {
+                callback(changes);
+              }
+              catch (...) {
+                error = std::current_exception();
+              }
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                calling = false;
+                if (error) {
+                  callbackError = error;
+                }
+              }
+              condition.notify_all();
+            }
+          }
+        }
+
+        bool isCancelled()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          return cancelled;
+        }
+
+        /// Consul may reset its index, in which case the next query must start over from 0. An index of 0 is invalid
+        /// and would not block, so it is raised to 1.
+        void updateIndex(std::uint64_t newIndex)
+        {
+          index = newIndex < index ? 0 : std::max<std::uint64_t>(newIndex, 1);
+        }
+
+        /// Compares the modify indexes of the keys with the previous ones, and remembers them
+        auto findChanges(std::vector<ppconsul::kv::KeyValue>& items) -> std::vector<KeyChange>
+        {
+          std::vector<KeyChange> changes;
+          std::map<std::string, std::uint64_t> newModifyIndexes;
+          for (auto& item : items) {
+            auto previous = modifyIndexes.find(item.key);
+            if (previous == modifyIndexes.end() || previous->second != item.modifyIndex) {
+              changes.push_back({stripRequestKey(requestKey, item.key), std::move(item.value)});
+            }
+            newModifyIndexes.emplace(std::move(item.key), item.modifyIndex);
+          }
+          for (const auto& previous : modifyIndexes) {
+            if (newModifyIndexes.find(previous.first) == newModifyIndexes.end()) {
+              changes.push_back({stripRequestKey(requestKey, previous.first), boost::none});
+            }
+          }
+          std::sort(changes.begin(), changes.end(),
+              [](const KeyChange& a, const KeyChange& b) { return a.path < b.path; });
+          modifyIndexes.swap(newModifyIndexes);
+          return changes;
+        }
+
+        const std::string address;
+        const std::string requestKey;
+
+        /// Index of Consul for the prefix, and modify index of every key, as of the last query. Only used by the
+        /// thread, after the constructor.
+        std::uint64_t index = 0;
+        std::map<std::string, std::uint64_t> modifyIndexes;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        /// Only called with calling set, and cleared by cancel() once it is not
+        WatchCallback callback;
+        bool calling = false;
+        bool cancelled = false;
+        std::exception_ptr callbackError;
+    };
+
+    std::shared_ptr<State> mState;
+};
+
+ConsulBackend::ConsulBackend(const std::string& host, int port, std::size_t ioThreads) : mHost(host), mPort(port),
+    mConsul(host + ":" + std::to_string(port)), mStorage(mConsul), mIoThreads(ioThreads)
 {
 }
 
@@ -42,58 +301,196 @@ ConsulBackend::~ConsulBackend()
 void ConsulBackend::setPrefix(const std::string& path)
 {
   mPrefix = trimLeadingSlash(path);
+  mKeyCache.clear();
+}
+
+void ConsulBackend::setPathSeparator(char separator)
+{
+  BackendBase::setPathSeparator(separator);
+  mKeyCache.clear();
+}
+
+void ConsulBackend::resetPathSeparator()
+{
+  BackendBase::resetPathSeparator();
+  mKeyCache.clear();
 }
 
-/// Prefix the prefix to the path
-auto ConsulBackend::addPrefix(const std::string& path) -> std::string
+/// Turns a path into a Consul key: strips the leading slash, replaces the separators and prefixes the prefix.
+/// This is done in a single pass over the path, into a string that is allocated once.
+/// Note that unlike PathSegments, a trailing slash is kept, since it limits a recursive get to a "directory".
+auto ConsulBackend::makeKey(boost::string_view path) -> std::string
 {
-  return mPrefix + path;
+  if (!path.empty() && path.front() == '/') {
+    path.remove_prefix(1);
+  }
+
+  std::string key;
+  key.reserve(mPrefix.size() + path.size());
+  key.append(mPrefix);
+  const char separator = getSeparator();
+  for (char c : path) {
+    key.push_back(c == '/' ? separator : c);
+  }
+  return key;
 }
 
-/// Replace separators in the path
-auto ConsulBackend::replaceSeparator(const std::string& path) -> std::string
+auto ConsulBackend::getAddress() const -> std::string
 {
-  auto p = path;
-  std::replace(p.begin(), p.end(), '/', getSeparator());
-  return p;
+  return mHost + ":" + std::to_string(mPort);
+}
+
+auto ConsulBackend::ioPool() -> ThreadPool<Connection>&
+{
+  std::call_once(mIoPoolOnce, [this] {
+    auto address = getAddress();
+    mIoPool = std::make_unique<ThreadPool<Connection>>(mIoThreads, [address] {
+      return std::make_unique<Connection>(address);
+    });
+  });
+  return *mIoPool;
 }
 
 void ConsulBackend::putString(const std::string& path, const std::string& value)
 {
-  mStorage.put(addPrefix(replaceSeparator(trimLeadingSlash(path))), value);
+  mStorage.put(makeKey(path), value);
+}
+
+void ConsulBackend::putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic)
+{
+  if (atomic && pairs.size() > TRANSACTION_MAX_OPERATIONS) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Atomic putMany() of " + std::to_string(pairs.size())
+        + " values exceeds the Consul transaction limit of " + std::to_string(TRANSACTION_MAX_OPERATIONS)));
+  }
+
+  std::vector<std::pair<std::string, std::string>> keyValues;
+  keyValues.reserve(pairs.size());
+  for (const auto& pair : pairs) {
+    keyValues.emplace_back(makeKey(pair.first), Tree::convert<std::string>(pair.second));
+  }
+
+  std::vector<std::string> transactions;
+  for (std::size_t i = 0; i < keyValues.size(); i += TRANSACTION_MAX_OPERATIONS) {
+    auto end = std::min(i + TRANSACTION_MAX_OPERATIONS, keyValues.size());
+    transactions.push_back(makeTransaction(keyValues.begin() + i, keyValues.begin() + end));
+  }
+
+  if (transactions.size() == 1) {
+    mConsul.put("/v1/txn", transactions.front());
+    return;
+  }
+
+  // After a failure, the transactions that did not start yet are skipped
+  auto failed = std::make_shared<std::atomic<bool>>(false);
+  std::vector<std::future<void>> results;
+  for (auto& transaction : transactions) {
+    results.push_back(ioPool().submit([failed, body = std::move(transaction)](Connection& connection) {
+      if (*failed) {
+        return;
+      }
+      try {
+        connection.consul.put("/v1/txn", body);
+      }
+      catch (...) {
+        *failed = true;
+        throw;
+      }
+    }));
+  }
+  for (auto& result : results) {
+    result.wait();
+  }
+  for (auto& result : results) {
+    result.get();
+  }
 }
 
 auto ConsulBackend::getString(const std::string& path) -> Optional<std::string>
 {
-  auto item = mStorage.item(addPrefix(replaceSeparator(trimLeadingSlash(path))),
-      ppconsul::keywords::consistency = ppconsul::Consistency::Stale);
-  if (item.valid()) {
-    return std::move(item.value);
-  } else {
-    return {};
+  return getItem(mStorage, makeKey(path));
+}
+
+auto ConsulBackend::getString(const Path& path) -> Optional<std::string>
+{
+  auto iter = mKeyCache.find(path);
+  if (iter == mKeyCache.end()) {
+    iter = mKeyCache.emplace(path, makeKey(path.string())).first;
   }
+  return getItem(mStorage, iter->second);
 }
 
-auto ConsulBackend::getItems(const std::string& requestKey) -> std::vector<ppconsul::kv::KeyValue>
+auto ConsulBackend::getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>>
 {
-  return mStorage.items(requestKey, ppconsul::keywords::consistency = ppconsul::Consistency::Stale);
+  std::vector<std::string> keys;
+  keys.reserve(paths.size());
+  for (const auto& path : paths) {
+    keys.push_back(makeKey(path));
+  }
+
+  std::size_t prefixLength = keys.empty() ? 0 : keys.front().size();
+  for (const auto& key : keys) {
+    prefixLength = std::min(prefixLength, commonPrefixLength(keys.front(), key));
+  }
+  // A recursive get of a partial segment would also fetch its siblings that start the same way, such as "link_10" for
+  // "link_1", so the prefix is cut back to the directory containing all keys, including its separator
+  auto separatorPosition = prefixLength == 0 ? std::string::npos : keys.front().rfind(getSeparator(), prefixLength - 1);
+  prefixLength = separatorPosition == std::string::npos ? 0 : separatorPosition + 1;
+
+  std::vector<Optional<std::string>> values;
+  values.reserve(keys.size());
+  // A directory above the configured prefix could hold much more than the configuration asked for
+  if (keys.size() < 2 || prefixLength == 0 || prefixLength < mPrefix.size()) {
+    for (const auto& key : keys) {
+      values.push_back(getItem(mStorage, key));
+    }
+    return values;
+  }
+
+  auto items = getItems(mStorage, keys.front().substr(0, prefixLength));
+  auto byKey = [](const ppconsul::kv::KeyValue& a, const ppconsul::kv::KeyValue& b) { return a.key < b.key; };
+  std::sort(items.begin(), items.end(), byKey);
+  for (const auto& key : keys) {
+    auto iter = std::lower_bound(items.begin(), items.end(), key, [](const ppconsul::kv::KeyValue& item,
+        const std::string& key) { return item.key < key; });
+    if (iter != items.end() && iter->key == key) {
+      values.push_back(iter->value);
+    } else {
+      values.push_back(boost::none);
+    }
+  }
+  return values;
 }
 
 auto ConsulBackend::getRecursive(const std::string& path) -> Tree::Node
 {
-  auto requestKey = addPrefix(replaceSeparator(trimLeadingSlash(path)));
-  auto items = getItems(requestKey);
-  std::vector<std::pair<std::string, Tree::Leaf>> keyValuePairs(items.size());
-  for (const auto& item : items) {
-    keyValuePairs.emplace_back(stripRequestKey(requestKey, item.key), std::move(item.value));
-  }
-  return Tree::keyValuesToTree(keyValuePairs);
+  return getTree(mStorage, makeKey(path));
+}
+
+auto ConsulBackend::getStringAsync(const std::string& path) -> std::future<Optional<std::string>>
+{
+  // The key is made on the calling thread, since the prefix and separator may change afterwards
+  return ioPool().submit([key = makeKey(path)](Connection& connection) { return getItem(connection.storage, key); });
+}
+
+auto ConsulBackend::putStringAsync(const std::string& path, const std::string& value) -> std::future<void>
+{
+  return ioPool().submit([key = makeKey(path), value](Connection& connection) { connection.storage.put(key, value); });
+}
+
+auto ConsulBackend::getRecursiveAsync(const std::string& path) -> std::future<Tree::Node>
+{
+  return ioPool().submit([key = makeKey(path)](Connection& connection) { return getTree(connection.storage, key); });
+}
+
+auto ConsulBackend::watch(const std::string& path, WatchCallback callback) -> std::unique_ptr<Watch>
+{
+  return std::make_unique<ConsulWatch>(mStorage, getAddress(), makeKey(path), std::move(callback));
 }
 
 auto ConsulBackend::getRecursiveMap(const std::string& path) -> KeyValueMap
 {
-  auto requestKey = addPrefix(replaceSeparator(trimLeadingSlash(path)));
-  auto items = getItems(requestKey);
+  auto requestKey = makeKey(path);
+  auto items = getItems(mStorage, requestKey);
   KeyValueMap map;
   for (const auto& item : items) {
     map[stripRequestKey(requestKey, item.key)] = std::move(item.value);
@@ -101,6 +498,15 @@ auto ConsulBackend::getRecursiveMap(const std::string& path) -> KeyValueMap
   return map;
 }
 
+auto ConsulBackend::memoryUsage() const -> std::size_t
+{
+  std::size_t bytes = sizeof(*this) + Tree::heapBytes(mHost) + Tree::heapBytes(mPrefix) + pathCacheBytes(mKeyCache);
+  for (const auto& keyValuePair : mKeyCache) {
+    bytes += Tree::heapBytes(keyValuePair.second);
+  }
+  return bytes;
+}
+
 } // namespace Backends
 } // namespace Configuration
 } // namespace AliceO2
@@ -7,8 +7,15 @@
 #define ALICEO2_CONFIGURATION_SRC_BACKENDS_CONSUL_CONSULBACKEND_H_
 
 #include "../BackendBase.h"
+#include "../ThreadPool.h"
 #include <ppconsul/kv.h>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/utility/string_view.hpp>
 
 namespace AliceO2
 {
@@ -21,24 +28,78 @@ namespace Backends
 class ConsulBackend final : public BackendBase
 {
   public:
-    ConsulBackend(const std::string& host, int port);
+    /// Amount of I/O threads, if not given
+    static constexpr std::size_t DEFAULT_IO_THREADS = 8;
+
+    /// \param host Host of the Consul agent
+    /// \param port Port of the Consul agent
+    /// \param ioThreads Amount of threads of the I/O pool, which runs the asynchronous requests and putMany(). Each
+    ///   has its own connection. The threads are started on the first request that needs them.
+    ConsulBackend(const std::string& host, int port, std::size_t ioThreads = DEFAULT_IO_THREADS);
     virtual ~ConsulBackend();
     virtual void putString(const std::string& path, const std::string& value) override;
+
+    /// Puts the values with Consul transactions of up to 64 operations, the limit of Consul, sent concurrently by the
+    /// I/O threads. An atomic put is a single transaction, so it is limited to 64 values.
+    virtual void putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic) override;
     virtual auto getString(const std::string& path) -> Optional<std::string> override;
+    virtual auto getString(const Path& path) -> Optional<std::string> override;
+
+    /// Gets the values with one recursive request for the deepest directory containing all of their keys, rather than
+    /// one request per key. This suits the values of a component, which share its directory. Keys that only share the
+    /// root, or a directory above the prefix, fall back to one request per key, since that could fetch the whole store.
+    virtual auto getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>> override;
     virtual void setPrefix(const std::string& path) override;
+    virtual void setPathSeparator(char separator) override;
+    virtual void resetPathSeparator() override;
     virtual auto getRecursive(const std::string& path) -> Tree::Node override;
+    virtual auto getStringAsync(const std::string& path) -> std::future<Optional<std::string>> override;
+    virtual auto putStringAsync(const std::string& path, const std::string& value) -> std::future<void> override;
+    virtual auto getRecursiveAsync(const std::string& path) -> std::future<Tree::Node> override;
+
+    /// Watches the values with Consul blocking queries, on a thread of the watch with its own connection. A query
+    /// returns when the index of the prefix changes, or after a wait of 5 minutes. Cancelling does not wait for a query
+    /// in progress, whose result is ignored. The changed values are found by comparing the modify indexes of the keys.
+    /// After a failure, the thread reconnects with a randomised exponential backoff of up to 30 seconds, and then
+    /// delivers the changes it missed. Exceptions thrown by the callback are kept, see Watch::callbackError().
+    virtual auto watch(const std::string& path, WatchCallback callback) -> std::unique_ptr<Watch> override;
     virtual auto getRecursiveMap(const std::string&) -> KeyValueMap override;
+    virtual auto memoryUsage() const -> std::size_t override;
 
   private:
-    auto addPrefix(const std::string& path) -> std::string;
-    auto replaceSeparator(const std::string& path) -> std::string;
-    auto getItems(const std::string& path) -> std::vector<ppconsul::kv::KeyValue>;
+    /// Connection of an I/O thread
+    struct Connection
+    {
+        explicit Connection(const std::string& address) : consul(address), storage(consul)
+        {
+        }
+
+        ppconsul::Consul consul;
+        ppconsul::kv::Storage storage;
+    };
+
+    class ConsulWatch;
+
+    auto makeKey(boost::string_view path) -> std::string;
+    auto getAddress() const -> std::string;
+    auto ioPool() -> ThreadPool<Connection>&;
 
     std::string mHost;
     int mPort;
     std::string mPrefix;
     ppconsul::Consul mConsul;
     ppconsul::kv::Storage mStorage;
+
+    /// Consul keys of precompiled paths
+    std::unordered_map<Path, std::string, Path::Hash> mKeyCache;
+
+    std::size_t mIoThreads;
+
+    /// Creates mIoPool on first use, which may be from concurrent asynchronous calls
+    std::once_flag mIoPoolOnce;
+
+    /// Runs the asynchronous requests. It is the last member, so its threads are stopped before the rest is destroyed.
+    std::unique_ptr<ThreadPool<Connection>> mIoPool;
 };
 
 } // namespace Backends
@@ -5,6 +5,7 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "FileBackend.h"
+#include <algorithm>
 #include <vector>
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -70,12 +71,85 @@ auto FileBackend::getString(const std::string& path) -> Optional<std::string>
   return mPropertyTree.get_optional<std::string>(decltype(mPropertyTree)::path_type(path, getSeparator()));
 }
 
+auto FileBackend::getString(const Path& path) -> Optional<std::string>
+{
+  auto iter = mPathCache.find(path);
+  if (iter == mPathCache.end()) {
+    auto child = mPropertyTree.get_child_optional(decltype(mPropertyTree)::path_type(path.string(), getSeparator()));
+    iter = mPathCache.emplace(path, child ? child.get_ptr() : nullptr).first;
+  }
+
+  if (iter->second == nullptr) {
+    return {};
+  }
+  return iter->second->get_value_optional<std::string>();
+}
+
+auto FileBackend::getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>>
+{
+  using PropertyTree = boost::property_tree::ptree;
+  // The paths are split the way the property tree paths used by getString() split them, so both give the same values
+  auto splitPath = [separator = getSeparator()](boost::string_view path, std::vector<boost::string_view>& segments) {
+    while (!path.empty()) {
+      auto end = std::min(path.find(separator), path.size());
+      segments.push_back(path.substr(0, end));
+      path.remove_prefix(std::min(end + 1, path.size()));
+    }
+  };
+  auto nodes = findSortedSplit(mPropertyTree, paths, splitPath, [](const PropertyTree& node, boost::string_view key) {
+    auto iter = node.find(key.to_string());
+    return iter == node.not_found() ? nullptr : &iter->second;
+  });
+
+  std::vector<Optional<std::string>> values;
+  values.reserve(nodes.size());
+  for (const auto* node : nodes) {
+    values.push_back(node == nullptr ? Optional<std::string>() : node->get_value_optional<std::string>());
+  }
+  return values;
+}
+
 void FileBackend::setPrefix(const std::string& path)
 {
   mFilePath = path;
+  mPathCache.clear();
   loadConfigFile(mFilePath, mPropertyTree);
 }
 
+void FileBackend::setPathSeparator(char separator)
+{
+  BackendBase::setPathSeparator(separator);
+  mPathCache.clear();
+}
+
+void FileBackend::resetPathSeparator()
+{
+  BackendBase::resetPathSeparator();
+  mPathCache.clear();
+}
+
+namespace
+{
+/// Estimates the heap bytes of a property tree, not including the tree object itself
+auto propertyTreeBytes(const boost::property_tree::ptree& tree) -> std::size_t
+{
+  // Every property tree allocates a container for its children, and every child is a container node linked into a
+  // sequenced and an ordered index
+  constexpr std::size_t CONTAINER_BYTES = 8 * sizeof(void*);
+  constexpr std::size_t CONTAINER_NODE_OVERHEAD = 5 * sizeof(void*);
+  std::size_t bytes = CONTAINER_BYTES + Tree::heapBytes(tree.data());
+  for (const auto& child : tree) {
+    bytes += CONTAINER_NODE_OVERHEAD + sizeof(child) + Tree::heapBytes(child.first) + propertyTreeBytes(child.second);
+  }
+  return bytes;
+}
+} // Anonymous namespace
+
+auto FileBackend::memoryUsage() const -> std::size_t
+{
+  return sizeof(*this) + Tree::heapBytes(mFilePath) + propertyTreeBytes(mPropertyTree) + pathCacheBytes(mPathCache);
+}
+
 } // namespace Configuration
 } // namespace Backends
 } // namespace AliceO2
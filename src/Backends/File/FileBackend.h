@@ -8,6 +8,8 @@
 #define ALICEO2_CONFIGURATION_SRC_BACKENDS_FILE_FILEBACKEND_H_
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <boost/property_tree/ptree.hpp>
 #include "../BackendBase.h"
 
@@ -26,11 +28,19 @@ class FileBackend final : public BackendBase
     virtual ~FileBackend();
     virtual void putString(const std::string& path, const std::string& value) override;
     virtual auto getString(const std::string& path) -> Optional<std::string> override;
+    virtual auto getString(const Path& path) -> Optional<std::string> override;
+    virtual auto getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>> override;
     virtual void setPrefix(const std::string& path) override;
+    virtual void setPathSeparator(char separator) override;
+    virtual void resetPathSeparator() override;
+    virtual auto memoryUsage() const -> std::size_t override;
 
   private:
     std::string mFilePath;
     boost::property_tree::ptree mPropertyTree;
+
+    /// Nodes that precompiled paths resolved to, or nullptr if they did not exist
+    std::unordered_map<Path, const boost::property_tree::ptree*, Path::Hash> mPathCache;
 };
 
 } // namespace Backends
@@ -30,6 +30,7 @@ auto jsonToTree(const std::string& json) -> Tree::Node
   reader.Parse(ss, handler);
   return Tree::keyValuesToTree(handler.keyValues);
 }
+
 } // Anonymous namespace
 
 JsonBackend::~JsonBackend()
@@ -41,7 +42,7 @@ JsonBackend::JsonBackend(const std::string& filePath)
 {
   std::ifstream stream(filePath);
   std::string json((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
-  mRootNode = jsonToTree(json);
+  mRootNode = Tree::SharedNode(jsonToTree(json));
   mCurrentNode = mRootNode;
 }
 
@@ -52,31 +53,72 @@ void JsonBackend::putString(const std::string&, const std::string&)
 
 auto JsonBackend::getString(const std::string& path) -> Optional<std::string>
 {
-  const Tree::Node& node = Tree::getSubtree(mRootNode, path);
-  return Tree::get<std::string>(node);
+  const Tree::Node* node = Tree::find(*mRootNode, path);
+  if (node == nullptr) {
+    return {};
+  }
+  return Tree::get<std::string>(*node);
+}
+
+auto JsonBackend::getString(const Path& path) -> Optional<std::string>
+{
+  // mRootNode never changes after construction, so the pointers stay valid
+  auto iter = mPathCache.find(path);
+  if (iter == mPathCache.end()) {
+    iter = mPathCache.emplace(path, Tree::find(*mRootNode, path.string())).first;
+  }
+
+  if (iter->second == nullptr) {
+    return {};
+  }
+  return Tree::get<std::string>(*iter->second);
+}
+
+auto JsonBackend::getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>>
+{
+  auto nodes = findSorted(*mRootNode, paths, '/', [](const Tree::Node& node, boost::string_view key) {
+    const auto* branch = boost::get<Tree::Branch>(&node);
+    return branch == nullptr ? nullptr : Tree::find(*branch, key);
+  });
+
+  std::vector<Optional<std::string>> values;
+  values.reserve(nodes.size());
+  for (const auto* node : nodes) {
+    values.push_back(node == nullptr ? Optional<std::string>() : Tree::get<std::string>(*node));
+  }
+  return values;
 }
 
 auto JsonBackend::getRecursive(const std::string& path) -> Tree::Node
 {
-  const Tree::Node& node = Tree::getSubtree(mCurrentNode, path);
+  const Tree::Node& node = Tree::getSubtree(*mCurrentNode, path);
   return node;
 }
 
+auto JsonBackend::getRecursiveShared(const std::string& path) -> Tree::SharedNode
+{
+  return mCurrentNode.getSubtree(path);
+}
+
 auto JsonBackend::getRecursiveMap(const std::string& path) -> KeyValueMap
 {
   KeyValueMap map;
-  const Tree::Node& node = Tree::getSubtree(mCurrentNode, path);
-  const std::vector<std::pair<std::string, Tree::Leaf>> keyValues = Tree::treeToKeyValues(node);
-  for (const auto& pair : keyValues) {
-    map[pair.first] = Tree::convert<std::string>(pair.second);
+  for (const auto& leaf : Tree::LeafRange(Tree::getSubtree(*mCurrentNode, path))) {
+    map.emplace(leaf.first.to_string(), Tree::convert<std::string>(leaf.second));
   }
   return map;
 }
 
 void JsonBackend::setPrefix(const std::string& path)
 {
-  const Tree::Node& node = Tree::getSubtree(mRootNode, path);
-  mCurrentNode = node;
+  mCurrentNode = mRootNode.getSubtree(path);
+}
+
+auto JsonBackend::memoryUsage() const -> std::size_t
+{
+  // mCurrentNode shares the tree of mRootNode, so the tree is only counted once
+  return sizeof(*this) + Tree::heapBytes(mFilePath) + sizeof(Tree::Node) + Tree::heapBytes(*mRootNode)
+      + pathCacheBytes(mPathCache);
 }
 
 } // namespace Backends
@@ -7,6 +7,7 @@
 #define ALICEO2_CONFIGURATION_SRC_JSONBACKENDH_
 
 #include <string>
+#include <unordered_map>
 #include <boost/property_tree/ptree.hpp>
 #include "../BackendBase.h"
 
@@ -25,14 +26,24 @@ class JsonBackend final : public BackendBase
     virtual ~JsonBackend();
     virtual void putString(const std::string& path, const std::string& value) override;
     virtual auto getString(const std::string& path) -> Optional<std::string> override;
+    virtual auto getString(const Path& path) -> Optional<std::string> override;
+    virtual auto getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>> override;
     virtual void setPrefix(const std::string& path) override;
     virtual auto getRecursive(const std::string& path) -> Tree::Node override;
+    virtual auto getRecursiveShared(const std::string& path) -> Tree::SharedNode override;
     virtual auto getRecursiveMap(const std::string& path) -> KeyValueMap override;
+    virtual auto memoryUsage() const -> std::size_t override;
 
   private:
     std::string mFilePath;
-    Tree::Node mRootNode;
-    Tree::Node mCurrentNode;
+    /// The whole tree of the file
+    Tree::SharedNode mRootNode;
+
+    /// The subtree at the current prefix, shares ownership with mRootNode
+    Tree::SharedNode mCurrentNode;
+
+    /// Nodes of mRootNode that precompiled paths resolved to, or nullptr if they did not exist
+    std::unordered_map<Path, const Tree::Node*, Path::Hash> mPathCache;
 };
 
 } // namespace Backends
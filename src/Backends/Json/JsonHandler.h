@@ -9,6 +9,7 @@
 #include <exception>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 #include <boost/throw_exception.hpp>
 #include <rapidjson/rapidjson.h>     // rapidjson's DOM-style API
@@ -37,7 +38,7 @@ struct JsonHandler {
     template <typename T>
     void setLeaf(T&& value)
     {
-      keyValues.push_back(std::make_pair(makeKey(), value));
+      keyValues.push_back(std::make_pair(makeKey(), std::forward<T>(value)));
       popPath();
     }
 
@@ -49,24 +50,37 @@ struct JsonHandler {
 
     bool Bool(bool value)
     {
+      checkNotInArray();
       setLeaf(value);
       return true;
     }
 
     bool Int(int value)
     {
+      if (inArray) {
+        addToArray(value);
+        return true;
+      }
       setLeaf(value);
       return true;
     }
 
     bool Uint(unsigned value)
     {
+      if (inArray) {
+        addToArray(value);
+        return true;
+      }
       setLeaf(int(value));
       return true;
     }
 
     bool Int64(int64_t value)
     {
+      if (inArray) {
+        addToArray(value);
+        return true;
+      }
       BOOST_THROW_EXCEPTION(std::runtime_error("int64_t not supported"));
       return true;
     }
@@ -79,6 +93,15 @@ struct JsonHandler {
 
     bool Double(double value)
     {
+      if (inArray) {
+        // Once there is a double, the whole array becomes an array of doubles
+        if (!arrayHasDouble) {
+          doubleArray = Tree::DoubleArray(intArray.begin(), intArray.end());
+          arrayHasDouble = true;
+        }
+        doubleArray.push_back(value);
+        return true;
+      }
       setLeaf(value);
       return true;
     }
@@ -91,12 +114,14 @@ struct JsonHandler {
 
     bool String(const char* str, rapidjson::SizeType length, bool copy)
     {
+      checkNotInArray();
       setLeaf(std::string(str));
       return true;
     }
 
     bool StartObject()
     {
+      checkNotInArray();
       return true;
     }
 
@@ -112,16 +137,44 @@ struct JsonHandler {
       return true;
     }
 
+    /// Arrays of numbers become a single array leaf: an IntArray if all elements are integers, a DoubleArray
+    /// otherwise. An empty array becomes an empty DoubleArray.
     bool StartArray()
     {
-      BOOST_THROW_EXCEPTION(std::runtime_error("Array not supported"));
-      return false;
+      checkNotInArray();
+      inArray = true;
+      arrayHasDouble = false;
+      intArray = Tree::IntArray();
+      doubleArray = Tree::DoubleArray();
+      return true;
     }
 
     bool EndArray(rapidjson::SizeType elementCount)
     {
-      BOOST_THROW_EXCEPTION(std::runtime_error("Array not supported"));
-      return false;
+      inArray = false;
+      if (arrayHasDouble || intArray.empty()) {
+        setLeaf(std::move(doubleArray));
+      } else {
+        setLeaf(std::move(intArray));
+      }
+      return true;
+    }
+
+    template <typename T>
+    void addToArray(T value)
+    {
+      if (arrayHasDouble) {
+        doubleArray.push_back(double(value));
+      } else {
+        intArray.push_back(std::int64_t(value));
+      }
+    }
+
+    void checkNotInArray()
+    {
+      if (inArray) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("Only arrays of numbers are supported"));
+      }
     }
 
     void pushPath(std::string path)
@@ -138,6 +191,12 @@ struct JsonHandler {
 
     std::vector<std::string> pathStack;
     std::vector<std::pair<std::string, Tree::Leaf>> keyValues;
+
+    // State of the array being parsed
+    bool inArray = false;
+    bool arrayHasDouble = false;
+    Tree::IntArray intArray;
+    Tree::DoubleArray doubleArray;
 };
 
 } // namespace Backends
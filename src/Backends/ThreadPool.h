@@ -0,0 +1,139 @@
+/// \file ThreadPool.h
+/// \brief Fixed-size thread pool for the I/O of backends
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#ifndef ALICEO2_CONFIGURATION_SRC_BACKENDS_THREADPOOL_H_
+#define ALICEO2_CONFIGURATION_SRC_BACKENDS_THREADPOOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/core/noncopyable.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Backends
+{
+
+/// Fixed amount of threads running tasks in the order they are submitted.
+/// Every thread has its own Context, for example a connection to a server, which is created on the thread before its
+/// first task and passed to every task the thread runs. This way, clients that are not thread-safe can be used by
+/// several threads at once.
+template <class Context>
+class ThreadPool : public boost::noncopyable
+{
+  public:
+    using ContextFactory = std::function<std::unique_ptr<Context>()>;
+
+    /// \param threads Amount of threads. At least one is started.
+    /// \param makeContext Creates the context of a thread. If it throws, the task the context was for gets the
+    ///   exception, and the next task tries again.
+    ThreadPool(std::size_t threads, ContextFactory makeContext) : mMakeContext(std::move(makeContext))
+    {
+      for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i) {
+        mThreads.emplace_back([this] { work(); });
+      }
+    }
+
+    /// Runs the tasks that were already submitted, then stops the threads
+    ~ThreadPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+      }
+      mCondition.notify_all();
+      for (auto& thread : mThreads) {
+        thread.join();
+      }
+    }
+
+    std::size_t size() const
+    {
+      return mThreads.size();
+    }
+
+    /// Queues a function to run on one of the threads
+    /// \param function Function taking a Context&
+    /// \return Future of the result of the function, or of the exception it threw
+    template <class Function>
+    auto submit(Function function) -> std::future<decltype(function(std::declval<Context&>()))>
+    {
+      using Result = decltype(function(std::declval<Context&>()));
+      auto task = std::make_shared<std::packaged_task<Result(Context*, std::exception_ptr)>>(
+          [function](Context* context, std::exception_ptr contextError) mutable {
+            if (context == nullptr) {
+              std::rethrow_exception(contextError);
+            }
+            return function(*context);
+          });
+      auto future = task->get_future();
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.emplace_back([task](Context* context, std::exception_ptr contextError) {
+          (*task)(context, contextError);
+        });
+      }
+      mCondition.notify_one();
+      return future;
+    }
+
+  private:
+    using Task = std::function<void(Context*, std::exception_ptr)>;
+
+    void work()
+    {
+      std::unique_ptr<Context> context;
+      while (true) {
+        Task task;
+        {
+          std::unique_lock<std::mutex> lock(mMutex);
+          mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+          if (mTasks.empty()) {
+            return;
+          }
+          task = std::move(mTasks.front());
+          mTasks.pop_front();
+        }
+
+        std::exception_ptr contextError;
+        if (!context) {
+          try {
+            context = mMakeContext();
+          }
+          catch (...) {
+            contextError = std::current_exception();
+          }
+          if (!context && !contextError) {
+            contextError = std::make_exception_ptr(std::runtime_error("Thread pool context could not be created"));
+          }
+        }
+        task(context.get(), contextError);
+      }
+    }
+
+    ContextFactory mMakeContext;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Task> mTasks;
+    bool mStopping = false;
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace Backends
+} // namespace Configuration
+} // namespace AliceO2
+
+#endif // ALICEO2_CONFIGURATION_SRC_BACKENDS_THREADPOOL_H_
@@ -0,0 +1,622 @@
+/// \file CachingBackend.cxx
+/// \brief Configuration interface that caches the values of another one
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/CachingBackend.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/utility/string_view.hpp>
+#include <boost/variant.hpp>
+#include "Configuration/TreeStats.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Backends
+{
+
+/// Sharded LRU map from keys to values or subtrees, with a TTL
+class CachingBackend::Cache
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Value = boost::variant<Optional<std::string>, Tree::SharedNode>;
+
+    explicit Cache(const Parameters& parameters)
+        : mTtl(parameters.ttl),
+          mShards(std::max<std::size_t>(parameters.shards, 1)),
+          mShardMaxEntries((parameters.maxEntries + mShards.size() - 1) / mShards.size()),
+          mShardMaxBytes((parameters.maxBytes + mShards.size() - 1) / mShards.size())
+    {
+    }
+
+    /// Gets an entry that has not expired, and marks it as the most recently used of its shard
+    auto get(const std::string& key) -> boost::optional<Value>
+    {
+      auto& shard = getShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto iter = shard.index.find(key);
+      if (iter == shard.index.end()) {
+        mMisses++;
+        return boost::none;
+      }
+      auto entry = iter->second;
+      if (entry->expiry <= Clock::now()) {
+        remove(shard, entry);
+        mExpirations++;
+        mMisses++;
+        return boost::none;
+      }
+      shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+      mHits++;
+      return entry->value;
+    }
+
+    /// Inserts or replaces an entry, evicting the least recently used entries of its shard to stay within the bounds.
+    /// An entry that is bigger than a whole shard is not inserted.
+    void put(const std::string& key, Value value)
+    {
+      auto bytes = ENTRY_OVERHEAD + Tree::heapBytes(key) + valueBytes(value);
+      auto& shard = getShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto iter = shard.index.find(key);
+      if (iter != shard.index.end()) {
+        remove(shard, iter->second);
+      }
+      if (bytes > mShardMaxBytes || mShardMaxEntries == 0) {
+        return;
+      }
+      while (!shard.entries.empty()
+          && (shard.entries.size() >= mShardMaxEntries || shard.bytes + bytes > mShardMaxBytes)) {
+        remove(shard, std::prev(shard.entries.end()));
+        mEvictions++;
+      }
+      auto expiry = mTtl.count() > 0 ? Clock::now() + mTtl : Clock::time_point::max();
+      shard.entries.push_front(Entry {key, std::move(value), bytes, expiry});
+      shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+      shard.bytes += bytes;
+      if (isTree(shard.entries.front().value)) {
+        std::lock_guard<std::mutex> treeKeysLock(mTreeKeysMutex);
+        mTreeKeys.insert(key);
+      }
+    }
+
+    /// Removes the subtrees whose keys are prefixes of the key. Only the tree keys that may be prefixes are visited.
+    void eraseTreesContaining(const std::string& key)
+    {
+      std::vector<std::string> found;
+      {
+        std::lock_guard<std::mutex> lock(mTreeKeysMutex);
+        std::string candidate = key;
+        while (true) {
+          // The greatest tree key not after the candidate is either a prefix of it, or shares the prefix that any
+          // shorter match must be part of
+          auto iter = mTreeKeys.upper_bound(candidate);
+          if (iter == mTreeKeys.begin()) {
+            break;
+          }
+          --iter;
+          if (boost::string_view(candidate).starts_with(*iter)) {
+            found.push_back(*iter);
+            if (iter->empty()) {
+              break;
+            }
+            candidate.resize(iter->size() - 1);
+          } else {
+            auto mismatch = std::mismatch(iter->begin(), iter->end(), candidate.begin());
+            candidate.resize(std::size_t(mismatch.second - candidate.begin()));
+          }
+        }
+      }
+      for (const auto& treeKey : found) {
+        erase(treeKey);
+      }
+    }
+
+    /// Removes an entry
+    /// \return True if there was one
+    bool erase(const std::string& key)
+    {
+      auto& shard = getShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto iter = shard.index.find(key);
+      if (iter == shard.index.end()) {
+        return false;
+      }
+      remove(shard, iter->second);
+      mInvalidations++;
+      return true;
+    }
+
+    void clear()
+    {
+      for (auto& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        while (!shard.entries.empty()) {
+          remove(shard, shard.entries.begin());
+        }
+      }
+    }
+
+    void countMissingHit()
+    {
+      mMissingHits++;
+    }
+
+    auto stats() const -> Stats
+    {
+      Stats stats;
+      stats.hits = mHits;
+      stats.missingHits = mMissingHits;
+      stats.misses = mMisses;
+      stats.evictions = mEvictions;
+      stats.expirations = mExpirations;
+      stats.invalidations = mInvalidations;
+      for (auto& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.entries.size();
+        stats.bytes += shard.bytes;
+      }
+      return stats;
+    }
+
+    /// Heap bytes of the cache, including its containers
+    auto memoryUsage() const -> std::size_t
+    {
+      std::size_t bytes = mShards.size() * sizeof(Shard);
+      for (auto& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.bytes + shard.index.bucket_count() * sizeof(void*);
+      }
+      std::lock_guard<std::mutex> lock(mTreeKeysMutex);
+      for (const auto& treeKey : mTreeKeys) {
+        bytes += TREE_KEY_OVERHEAD + Tree::heapBytes(treeKey);
+      }
+      return bytes;
+    }
+
+  private:
+    struct Entry
+    {
+        std::string key;
+        Value value;
+        std::size_t bytes;
+        Clock::time_point expiry;
+    };
+
+    using Entries = std::list<Entry>;
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+
+        /// Most recently used first
+        Entries entries;
+
+        /// Keys point into the entries, so they are not stored twice
+        std::unordered_map<boost::string_view, Entries::iterator, boost::hash<boost::string_view>> index;
+
+        std::size_t bytes = 0;
+    };
+
+    /// Estimated bytes of an entry besides its key and value: the list node, and the node and bucket of the index
+    static constexpr std::size_t ENTRY_OVERHEAD =
+        sizeof(Entry) + 2 * sizeof(void*) + sizeof(boost::string_view) + sizeof(Entries::iterator) + 3 * sizeof(void*);
+
+    /// Estimated bytes of a node of the tree keys besides the key
+    static constexpr std::size_t TREE_KEY_OVERHEAD = sizeof(std::string) + 4 * sizeof(void*);
+
+    static auto isTree(const Value& value) -> bool
+    {
+      return boost::get<Tree::SharedNode>(&value) != nullptr;
+    }
+
+    static auto valueBytes(const Value& value) -> std::size_t
+    {
+      if (const auto* string = boost::get<Optional<std::string>>(&value)) {
+        return *string ? Tree::heapBytes(**string) : 0;
+      }
+      // The subtree may be shared with the backend, but counting it keeps the bound on the memory it may pin
+      return sizeof(Tree::Node) + Tree::heapBytes(boost::get<Tree::SharedNode>(value).get());
+    }
+
+    auto getShard(const std::string& key) -> Shard&
+    {
+      return mShards[std::hash<std::string>()(key) % mShards.size()];
+    }
+
+    /// Removes an entry, whether it is evicted, expired or erased. The shard must be locked.
+    void remove(Shard& shard, Entries::iterator entry)
+    {
+      if (isTree(entry->value)) {
+        std::lock_guard<std::mutex> lock(mTreeKeysMutex);
+        mTreeKeys.erase(entry->key);
+      }
+      shard.bytes -= entry->bytes;
+      shard.index.erase(entry->key);
+      shard.entries.erase(entry);
+    }
+
+    const Clock::duration mTtl;
+    std::vector<Shard> mShards;
+    const std::size_t mShardMaxEntries;
+    const std::size_t mShardMaxBytes;
+
+    /// Keys of the entries holding subtrees, ordered to find the ones that are a prefix of a key. It is locked after
+    /// a shard when both are.
+    std::set<std::string> mTreeKeys;
+    mutable std::mutex mTreeKeysMutex;
+
+    std::atomic<std::size_t> mHits {0};
+    std::atomic<std::size_t> mMissingHits {0};
+    std::atomic<std::size_t> mMisses {0};
+    std::atomic<std::size_t> mEvictions {0};
+    std::atomic<std::size_t> mExpirations {0};
+    std::atomic<std::size_t> mInvalidations {0};
+};
+
+constexpr std::size_t CachingBackend::Cache::ENTRY_OVERHEAD;
+constexpr std::size_t CachingBackend::Cache::TREE_KEY_OVERHEAD;
+
+/// Watches of the wrapped backend, so they can be cancelled before it is destroyed
+/// Watches of the wrapped backend, so they can be cancelled before it is destroyed.
+/// They are cancelled without holding the mutex, since cancelling waits for a callback, which may itself make or cancel
+/// a watch.
+struct CachingBackend::Watches
+{
+    std::mutex mutex;
+    std::list<std::unique_ptr<Watch>> watches;
+    bool closed = false;
+
+    /// Watches that handles are cancelling, which the destructor of the CachingBackend waits for
+    std::size_t cancelling = 0;
+    std::condition_variable cancelled;
+};
+
+/// Handle of a watch of the wrapped backend, which stays safe to use after the CachingBackend is destroyed
+class CachingBackend::CachingWatch final : public Watch
+{
+  public:
+    CachingWatch(std::shared_ptr<Watches> watches, std::list<std::unique_ptr<Watch>>::iterator watch)
+        : mWatches(std::move(watches)), mWatch(watch)
+    {
+    }
+
+    virtual ~CachingWatch()
+    {
+      cancel();
+    }
+
+    virtual void cancel() override
+    {
+      std::unique_ptr<Watch> watch;
+      {
+        std::lock_guard<std::mutex> lock(mWatches->mutex);
+        if (mCancelled || mWatches->closed) {
+          return;
+        }
+        mCancelled = true;
+        watch = std::move(*mWatch);
+        mWatches->watches.erase(mWatch);
+        mWatches->cancelling++;
+      }
+      watch->cancel();
+      watch.reset();
+      {
+        std::lock_guard<std::mutex> lock(mWatches->mutex);
+        mWatches->cancelling--;
+      }
+      mWatches->cancelled.notify_all();
+    }
+
+    virtual std::exception_ptr callbackError() const override
+    {
+      std::lock_guard<std::mutex> lock(mWatches->mutex);
+      return mCancelled || mWatches->closed ? nullptr : (*mWatch)->callbackError();
+    }
+
+  private:
+    std::shared_ptr<Watches> mWatches;
+    std::list<std::unique_ptr<Watch>>::iterator mWatch;
+    bool mCancelled = false;
+};
+
+namespace
+{
+/// Paths are cached as given, since backends differ in which paths they consider the same. A change to a path is
+/// applied to it with and without a leading slash, like the Consul backend ignores it. Other backends either do not
+/// support changes, or distinguish the two.
+auto pathVariants(const std::string& path) -> std::array<std::string, 2>
+{
+  auto withoutSlash = !path.empty() && path.front() == '/' ? path.substr(1) : path;
+  return {{withoutSlash, '/' + withoutSlash}};
+}
+
+/// Keys of values and subtrees are kept apart by their first character
+auto valueKey(const std::string& path) -> std::string
+{
+  return 'v' + path;
+}
+
+auto treeKey(const std::string& path) -> std::string
+{
+  return 't' + path;
+}
+
+template <class T>
+auto readyFuture(T value) -> std::future<T>
+{
+  std::promise<T> promise;
+  promise.set_value(std::move(value));
+  return promise.get_future();
+}
+} // Anonymous namespace
+
+CachingBackend::CachingBackend(std::unique_ptr<ConfigurationInterface> backend, const Parameters& parameters)
+    : mBackend(std::move(backend)),
+      mCache(std::make_unique<Cache>(parameters)),
+      mCacheMissing(parameters.cacheMissing),
+      mWatches(std::make_shared<Watches>())
+{
+  if (!mBackend) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("CachingBackend needs a backend to cache"));
+  }
+}
+
+CachingBackend::CachingBackend(std::unique_ptr<ConfigurationInterface> backend)
+    : CachingBackend(std::move(backend), Parameters())
+{
+}
+
+CachingBackend::~CachingBackend()
+{
+  // The watches call back into this object, and may use the wrapped backend, so they are all stopped first
+  std::list<std::unique_ptr<Watch>> watches;
+  {
+    std::lock_guard<std::mutex> lock(mWatches->mutex);
+    watches.swap(mWatches->watches);
+    mWatches->closed = true;
+  }
+  for (auto& watch : watches) {
+    watch->cancel();
+  }
+  watches.clear();
+  std::unique_lock<std::mutex> lock(mWatches->mutex);
+  mWatches->cancelled.wait(lock, [this] { return mWatches->cancelling == 0; });
+}
+
+void CachingBackend::invalidate(const std::string& path)
+{
+  for (const auto& variant : pathVariants(path)) {
+    mCache->erase(valueKey(variant));
+    // A subtree may contain the path if its path is a prefix of it. Comparing characters rather than segments also
+    // matches siblings like "a/bc" for "a/b", which only costs a refetch, and covers backends that match prefixes.
+    mCache->eraseTreesContaining(treeKey(variant));
+  }
+}
+
+void CachingBackend::putString(const std::string& path, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  // Invalidating even if the put throws, since a failed put may have been partially applied
+  try {
+    mBackend->putString(path, value);
+  }
+  catch (...) {
+    invalidate(path);
+    throw;
+  }
+  invalidate(path);
+}
+
+void CachingBackend::putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic)
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  auto invalidateAll = [&] {
+    for (const auto& pair : pairs) {
+      invalidate(pair.first);
+    }
+  };
+  try {
+    mBackend->putMany(pairs, atomic);
+  }
+  catch (...) {
+    invalidateAll();
+    throw;
+  }
+  invalidateAll();
+}
+
+auto CachingBackend::getString(const std::string& path) -> Optional<std::string>
+{
+  auto key = valueKey(path);
+  if (auto cached = mCache->get(key)) {
+    auto& value = boost::get<Optional<std::string>>(*cached);
+    if (!value) {
+      mCache->countMissingHit();
+    }
+    return value;
+  }
+
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  auto value = mBackend->getString(path);
+  if (value || mCacheMissing) {
+    mCache->put(key, value);
+  }
+  return value;
+}
+
+auto CachingBackend::getString(const Path& path) -> Optional<std::string>
+{
+  return getString(path.string());
+}
+
+auto CachingBackend::getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>>
+{
+  std::vector<Optional<std::string>> values(paths.size());
+  std::vector<std::string> missedPaths;
+  std::vector<std::size_t> missedIndexes;
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    if (auto cached = mCache->get(valueKey(paths[i]))) {
+      values[i] = boost::get<Optional<std::string>>(*cached);
+      if (!values[i]) {
+        mCache->countMissingHit();
+      }
+    } else {
+      missedPaths.push_back(paths[i]);
+      missedIndexes.push_back(i);
+    }
+  }
+
+  if (!missedPaths.empty()) {
+    std::lock_guard<std::mutex> lock(mBackendMutex);
+    auto fetched = mBackend->getMany(missedPaths);
+    for (std::size_t i = 0; i < missedPaths.size(); ++i) {
+      if (fetched[i] || mCacheMissing) {
+        mCache->put(valueKey(missedPaths[i]), fetched[i]);
+      }
+      values[missedIndexes[i]] = std::move(fetched[i]);
+    }
+  }
+  return values;
+}
+
+auto CachingBackend::getStringAsync(const std::string& path) -> std::future<Optional<std::string>>
+{
+  if (auto cached = mCache->get(valueKey(path))) {
+    auto& value = boost::get<Optional<std::string>>(*cached);
+    if (!value) {
+      mCache->countMissingHit();
+    }
+    return readyFuture(value);
+  }
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  return mBackend->getStringAsync(path);
+}
+
+auto CachingBackend::putStringAsync(const std::string& path, const std::string& value) -> std::future<void>
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  // Invalidating before the put completes, so gets that miss until then may cache the old value again. They would
+  // also have seen it without the cache.
+  auto future = mBackend->putStringAsync(path, value);
+  invalidate(path);
+  return future;
+}
+
+void CachingBackend::setPrefix(const std::string& prefix)
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  mBackend->setPrefix(prefix);
+  clear();
+}
+
+void CachingBackend::setPathSeparator(char separator)
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  mBackend->setPathSeparator(separator);
+  clear();
+}
+
+void CachingBackend::resetPathSeparator()
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  mBackend->resetPathSeparator();
+  clear();
+}
+
+auto CachingBackend::getRecursive(const std::string& path) -> Tree::Node
+{
+  return getRecursiveShared(path).get();
+}
+
+auto CachingBackend::getRecursiveShared(const std::string& path) -> Tree::SharedNode
+{
+  auto key = treeKey(path);
+  if (auto cached = mCache->get(key)) {
+    return boost::get<Tree::SharedNode>(*cached);
+  }
+
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  auto tree = mBackend->getRecursiveShared(path);
+  mCache->put(key, tree);
+  return tree;
+}
+
+auto CachingBackend::getRecursiveAsync(const std::string& path) -> std::future<Tree::Node>
+{
+  if (auto cached = mCache->get(treeKey(path))) {
+    return readyFuture<Tree::Node>(boost::get<Tree::SharedNode>(*cached).get());
+  }
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  return mBackend->getRecursiveAsync(path);
+}
+
+auto CachingBackend::watch(const std::string& path, WatchCallback callback) -> std::unique_ptr<Watch>
+{
+  std::unique_ptr<Watch> watch;
+  {
+    std::lock_guard<std::mutex> lock(mBackendMutex);
+    // Capturing this is safe, since the destructor cancels the watch
+    watch = mBackend->watch(path, [this, path, callback = std::move(callback)](const std::vector<KeyChange>& changes) {
+      {
+        // Locking the backend, so a get that is in flight does not cache a value from before the change afterwards
+        std::lock_guard<std::mutex> lock(mBackendMutex);
+        for (const auto& change : changes) {
+          invalidate(path + change.path);
+        }
+      }
+      callback(changes);
+    });
+  }
+  // Registering without holding mBackendMutex, since a callback may be waiting for it while the watches are cancelled
+  std::lock_guard<std::mutex> lock(mWatches->mutex);
+  mWatches->watches.push_front(std::move(watch));
+  return std::make_unique<CachingWatch>(mWatches, mWatches->watches.begin());
+}
+
+auto CachingBackend::getRecursiveMap(const std::string& path) -> KeyValueMap
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  return mBackend->getRecursiveMap(path);
+}
+
+auto CachingBackend::reload() -> std::shared_ptr<const Snapshot>
+{
+  {
+    std::lock_guard<std::mutex> lock(mBackendMutex);
+    invalidate("");
+  }
+  return ConfigurationInterface::reload();
+}
+
+auto CachingBackend::memoryUsage() const -> std::size_t
+{
+  std::lock_guard<std::mutex> lock(mBackendMutex);
+  return sizeof(*this) + mCache->memoryUsage() + mBackend->memoryUsage();
+}
+
+auto CachingBackend::getStats() const -> Stats
+{
+  return mCache->stats();
+}
+
+void CachingBackend::clear()
+{
+  mCache->clear();
+}
+
+} // namespace Backends
+} // namespace Configuration
+} // namespace AliceO2
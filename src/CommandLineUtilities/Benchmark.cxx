@@ -0,0 +1,765 @@
+/// \file Benchmark.cxx
+/// \brief Command-line utility for benchmarking the Tree data structures
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include <boost/container/flat_map.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Program.h"
+#include "Configuration/CachingBackend.h"
+#include "Configuration/ConfigurationFactory.h"
+#include "Configuration/FlatTree.h"
+#include "Configuration/Tree.h"
+#include "Configuration/TreeBind.h"
+#include "Configuration/TreeStats.h"
+#include "Configuration/TreeWriter.h"
+
+namespace po = boost::program_options;
+namespace
+{
+using namespace AliceO2::Configuration;
+
+/// Creates a tree shaped like a readout configuration: equipments, each with a number of links that have a few
+/// parameters of every leaf type.
+Tree::Node makeReadoutTree(std::size_t leaves)
+{
+  constexpr std::size_t LINKS_PER_EQUIPMENT = 24;
+  std::vector<std::pair<std::string, Tree::Leaf>> pairs;
+  pairs.reserve(leaves);
+  for (std::size_t i = 0; pairs.size() < leaves; ++i) {
+    auto equipment = "/equipment_" + std::to_string(i / LINKS_PER_EQUIPMENT);
+    auto link = equipment + "/links/link_" + std::to_string(i % LINKS_PER_EQUIPMENT);
+    pairs.emplace_back(link + "/enabled", bool(i % 2));
+    pairs.emplace_back(link + "/threshold", int(i));
+    pairs.emplace_back(link + "/gain", 1.0 + double(i) / 1000.0);
+    pairs.emplace_back(link + "/name", "link_name_" + std::to_string(i));
+  }
+  pairs.resize(leaves);
+  return Tree::keyValuesToTree(pairs);
+}
+
+/// The parameters of a link of the readout tree, for the binding benchmark
+struct LinkParameters
+{
+    bool enabled;
+    int threshold;
+    double gain;
+    std::string name;
+
+    static auto treeFields()
+    {
+      return Tree::fields(
+          Tree::field("enabled", &LinkParameters::enabled),
+          Tree::field("threshold", &LinkParameters::threshold),
+          Tree::field("gain", &LinkParameters::gain),
+          Tree::field("name", &LinkParameters::name));
+    }
+};
+
+/// Picks random leaf paths from the tree
+std::vector<std::string> pickLeafPaths(const Tree::Node& tree, std::size_t amount)
+{
+  auto pairs = Tree::treeToKeyValues(tree);
+  std::vector<std::string> paths;
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<std::size_t> distribution(0, pairs.size() - 1);
+  for (std::size_t i = 0; i < amount; ++i) {
+    paths.push_back(pairs[distribution(generator)].first);
+  }
+  return paths;
+}
+
+/// The original treeToKeyValues() algorithm, which joins the whole path stack for every leaf, as a baseline
+void joinPathStack(const Tree::Node& node, std::vector<std::pair<std::string, Tree::Leaf>>& pairs,
+    std::vector<std::string>& pathStack)
+{
+  Visitor::apply(node,
+      [&](const Tree::Branch& branch) {
+        for (const auto& keyValuePair : branch) {
+          pathStack.push_back(keyValuePair.first);
+          joinPathStack(keyValuePair.second, pairs, pathStack);
+          pathStack.pop_back();
+        }
+      },
+      [&](const Tree::Leaf& leaf) {
+        std::ostringstream stream;
+        stream << '/';
+        for (std::size_t i = 0; i < pathStack.size(); ++i) {
+          stream << pathStack[i] << (i + 1 < pathStack.size() ? "/" : "");
+        }
+        pairs.emplace_back(stream.str(), leaf);
+      });
+}
+
+/// Timings of a branch container, in nanoseconds per child
+struct ContainerTimes
+{
+    double build;
+    double iterate;
+    double lookup;
+};
+
+/// Times building, iterating and looking up children in many branches of the given size, using Map as the branch
+/// container. The total amount of children is about the same for every size, so larger branches mean fewer of them.
+template <class Map>
+ContainerTimes measureContainer(std::size_t branchSize, std::size_t totalChildren, std::size_t lookups,
+    std::size_t& sink)
+{
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < branchSize; ++i) {
+    keys.push_back("parameter_" + std::to_string(i));
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::size_t branchCount = std::max<std::size_t>(1, totalChildren / branchSize);
+  std::vector<Map> branches(branchCount);
+  auto build = measure(1, [&](std::size_t) {
+    for (auto& branch : branches) {
+      for (std::size_t i = 0; i < branchSize; ++i) {
+        branch.emplace_hint(branch.end(), keys[i], Tree::Leaf(int(i)));
+      }
+    }
+  });
+
+  auto iterate = measure(1, [&](std::size_t) {
+    for (const auto& branch : branches) {
+      for (const auto& keyValuePair : branch) {
+        sink += keyValuePair.first.size() + std::size_t(keyValuePair.second.which());
+      }
+    }
+  });
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<std::size_t> branchDistribution(0, branchCount - 1);
+  std::uniform_int_distribution<std::size_t> keyDistribution(0, branchSize - 1);
+  std::vector<std::pair<std::size_t, boost::string_view>> queries;
+  for (std::size_t i = 0; i < 4096; ++i) {
+    queries.emplace_back(branchDistribution(generator), keys[keyDistribution(generator)]);
+  }
+  auto lookup = measure(lookups, [&](std::size_t i) {
+    const auto& query = queries[i % queries.size()];
+    sink += std::size_t(branches[query.first].find(query.second)->second.which());
+  });
+
+  double children = double(branchCount * branchSize);
+  return {build / children, iterate / children, lookup};
+}
+
+/// The boost::variant Tree::Leaf used to be, as a baseline
+using VariantLeaf = boost::variant<std::string, int, double, bool, Tree::DoubleArray, Tree::IntArray>;
+
+/// The Tree::convert() of VariantLeaf, which compares the typeid before converting
+template <class T>
+T convertVariantLeaf(const VariantLeaf& variant)
+{
+  if (variant.type() == typeid(T)) {
+    return boost::get<T>(variant);
+  }
+  return Visitor::apply<T>(variant,
+      [](const std::string& value) { return boost::lexical_cast<T>(value); },
+      [](int value) { return boost::lexical_cast<T>(value); },
+      [](bool value) { return boost::lexical_cast<T>(value); },
+      [](double value) { return boost::lexical_cast<T>(value); },
+      [](const Tree::DoubleArray&) -> T { throw boost::bad_lexical_cast(); },
+      [](const Tree::IntArray&) -> T { throw boost::bad_lexical_cast(); });
+}
+
+/// Runs the function the given amount of times and returns the average time per call in nanoseconds
+double measure(std::size_t iterations, const std::function<void(std::size_t)>& function)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    function(i);
+  }
+  auto duration = std::chrono::steady_clock::now() - start;
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) / double(iterations);
+}
+
+/// Backend serving a tree from memory. Every reload copies the tree, like a backend fetching the whole configuration.
+class TreeBackend : public ConfigurationInterface
+{
+  public:
+    explicit TreeBackend(const Tree::Node& tree) : mTree(tree)
+    {
+    }
+
+    virtual void putString(const std::string&, const std::string&) override
+    {
+      throw std::runtime_error("TreeBackend does not support putting values");
+    }
+
+    virtual Optional<std::string> getString(const std::string& path) override
+    {
+      return Tree::tryGet<std::string>(mTree, path);
+    }
+
+    virtual void setPrefix(const std::string&) override
+    {
+    }
+
+    virtual void setPathSeparator(char) override
+    {
+    }
+
+    virtual void resetPathSeparator() override
+    {
+    }
+
+    virtual Tree::Node getRecursive(const std::string& path) override
+    {
+      return Tree::getSubtree(mTree, path);
+    }
+
+    virtual KeyValueMap getRecursiveMap(const std::string&) override
+    {
+      throw std::runtime_error("TreeBackend does not support getRecursiveMap()");
+    }
+
+  private:
+    const Tree::Node& mTree;
+};
+
+/// Runs the function on the given amount of threads, each calling it the given amount of times, and returns the
+/// average time per call in nanoseconds of wall time. The results of the calls are summed into the sink per thread, so
+/// the threads do not contend on it.
+double measureParallel(std::size_t threads, std::size_t iterations,
+    const std::function<std::size_t(std::size_t)>& function, std::atomic<std::size_t>& sink)
+{
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t thread = 0; thread < threads; ++thread) {
+    workers.emplace_back([&, thread] {
+      std::size_t sum = 0;
+      for (std::size_t i = 0; i < iterations; ++i) {
+        sum += function(thread * iterations + i);
+      }
+      sink += sum;
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto duration = std::chrono::steady_clock::now() - start;
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())
+      / double(threads * iterations);
+}
+
+class Benchmark : public AliceO2::Configuration::Program
+{
+    virtual Description getDescription() override
+    {
+      return {"configuration-benchmark", "Benchmarks the Tree data structures on a synthetic readout configuration",
+        "configuration-benchmark --leaves=1000000 --lookups=1000000"};
+    }
+
+    virtual void addOptions(boost::program_options::options_description& optionsDescription) override
+    {
+      optionsDescription.add_options()
+          ("leaves,l", po::value<std::size_t>(&mLeaves)->default_value(200000), "Amount of leaves in the tree")
+          ("lookups,n", po::value<std::size_t>(&mLookups)->default_value(1000000), "Amount of lookups to time")
+          ("threads,t", po::value<std::size_t>(&mThreads)->default_value(std::thread::hardware_concurrency()),
+              "Amount of threads for the parallel benchmarks")
+          ("binary-file,f", po::value<std::string>(&mBinaryFile)->default_value("/tmp/configuration-benchmark.tree"),
+              "Temporary file for the binary format benchmark");
+    }
+
+    virtual void run(const boost::program_options::variables_map&) override
+    {
+      auto tree = makeReadoutTree(mLeaves);
+      auto paths = pickLeafPaths(tree, 4096);
+      std::cout << "Tree with " << mLeaves << " leaves\n";
+      benchmarkFlatTree(tree, paths);
+      benchmarkMisses(tree, paths);
+      benchmarkBinaryFile(tree, paths);
+      benchmarkKeyValuesToTree(tree);
+      benchmarkTreeToKeyValues(tree);
+      benchmarkWriters(tree);
+      benchmarkBind(tree);
+      benchmarkBranchContainers();
+      benchmarkLeaves(tree);
+      benchmarkGetMany();
+      benchmarkCaching();
+      benchmarkSnapshots(tree, paths);
+    }
+
+    void benchmarkFlatTree(const Tree::Node& tree, const std::vector<std::string>& paths)
+    {
+      std::cout << "\n#### FlatTree vs Node\n";
+
+      Tree::FlatTree flatTree;
+      auto buildTime = measure(1, [&](std::size_t) { flatTree = Tree::FlatTree(tree); });
+
+      std::size_t sink = 0;
+      auto nodeLookup = measure(mLookups, [&](std::size_t i) {
+        sink += std::size_t(Tree::getSubtree(tree, paths[i % paths.size()]).which());
+      });
+      auto flatLookup = measure(mLookups, [&](std::size_t i) {
+        sink += std::size_t(flatTree.getSubtree(paths[i % paths.size()]).type());
+      });
+
+      auto nodeBytes = Tree::heapBytes(tree);
+      auto flatBytes = flatTree.memoryUsage();
+
+      print("Flatten time (ms)", buildTime / 1e6);
+      print("Node lookup (ns)", nodeLookup);
+      print("FlatTree lookup (ns)", flatLookup);
+      print("Node memory (MiB, estimate)", double(nodeBytes) / (1 << 20));
+      print("FlatTree memory (MiB)", double(flatBytes) / (1 << 20));
+      print("Lookup speedup", nodeLookup / flatLookup);
+      print("Memory reduction", double(nodeBytes) / double(flatBytes));
+      consume(sink);
+    }
+
+    /// Compares lookups of paths that do not exist, through exceptions and through the non-throwing API
+    void benchmarkMisses(const Tree::Node& tree, const std::vector<std::string>& paths)
+    {
+      std::cout << "\n#### Missing keys\n";
+
+      std::vector<std::string> missing;
+      for (const auto& path : paths) {
+        missing.push_back(path + "_tuning");
+      }
+
+      std::size_t sink = 0;
+      auto hits = measure(mLookups, [&](std::size_t i) {
+        sink += std::size_t(Tree::find(tree, paths[i % paths.size()]) != nullptr);
+      });
+      auto misses = measure(mLookups, [&](std::size_t i) {
+        sink += std::size_t(Tree::find(tree, missing[i % missing.size()]) != nullptr);
+      });
+      // Exceptions are much slower, so fewer of them are timed
+      std::size_t throwingLookups = std::max<std::size_t>(mLookups / 100, 1);
+      auto throwingMisses = measure(throwingLookups, [&](std::size_t i) {
+        try {
+          sink += std::size_t(Tree::getSubtree(tree, missing[i % missing.size()]).which());
+        }
+        catch (const std::out_of_range&) {
+          sink++;
+        }
+      });
+      Tree::Leaf malformed("not a number");
+      auto conversionMisses = measure(mLookups, [&](std::size_t) {
+        sink += std::size_t(Tree::tryConvert<int>(malformed).get_value_or(0));
+      });
+      auto throwingConversionMisses = measure(throwingLookups, [&](std::size_t) {
+        try {
+          sink += std::size_t(Tree::convert<int>(malformed));
+        }
+        catch (const boost::bad_lexical_cast&) {
+          sink++;
+        }
+      });
+
+      print("find() hit (ns)", hits);
+      print("find() miss (ns)", misses);
+      print("getSubtree() miss, caught (ns)", throwingMisses);
+      print("tryConvert() failure (ns)", conversionMisses);
+      print("convert() failure, caught (ns)", throwingConversionMisses);
+      consume(sink);
+    }
+
+    void benchmarkBinaryFile(const Tree::Node& tree, const std::vector<std::string>& paths)
+    {
+      std::cout << "\n#### Binary file\n";
+
+      Tree::FlatTree flatTree(tree);
+      auto writeTime = measure(1, [&](std::size_t) { flatTree.writeFile(mBinaryFile); });
+
+      std::size_t sink = 0;
+      Tree::FlatTree mapped;
+      auto mapTime = measure(1, [&](std::size_t) { mapped = Tree::FlatTree::mapFile(mBinaryFile); });
+      auto verifiedMapTime = measure(1, [&](std::size_t) { sink += Tree::FlatTree::mapFile(mBinaryFile, true).size(); });
+      auto firstLookups = measure(paths.size(), [&](std::size_t i) {
+        sink += std::size_t(mapped.getSubtree(paths[i]).type());
+      });
+      auto lookups = measure(mLookups, [&](std::size_t i) {
+        sink += std::size_t(mapped.getSubtree(paths[i % paths.size()]).type());
+      });
+      std::remove(mBinaryFile.c_str());
+
+      print("File size (MiB)", double(mapped.memoryUsage()) / (1 << 20));
+      print("Write (ms)", writeTime / 1e6);
+      print("Map (us)", mapTime / 1e3);
+      print("Map with checksum (ms)", verifiedMapTime / 1e6);
+      print("First lookups (ns)", firstLookups);
+      print("Lookups (ns)", lookups);
+      consume(sink);
+    }
+
+    void benchmarkKeyValuesToTree(const Tree::Node& tree)
+    {
+      std::cout << "\n#### keyValuesToTree\n";
+
+      auto sorted = Tree::treeToKeyValues(tree);
+      auto shuffled = sorted;
+      std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+      std::size_t sink = 0;
+      auto build = [&](const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, std::size_t threads) {
+        return measure(1, [&](std::size_t) { sink += Tree::getBranch(Tree::keyValuesToTree(pairs, threads)).size(); });
+      };
+
+      print("Sorted input (ms)", build(sorted, 1) / 1e6);
+      print("Shuffled input (ms)", build(shuffled, 1) / 1e6);
+      print("Shuffled input, " + std::to_string(mThreads) + " threads (ms)", build(shuffled, mThreads) / 1e6);
+      consume(sink);
+    }
+
+    void benchmarkTreeToKeyValues(const Tree::Node& tree)
+    {
+      std::cout << "\n#### treeToKeyValues\n";
+
+      std::size_t sink = 0;
+      auto baseline = measure(1, [&](std::size_t) {
+        std::vector<std::pair<std::string, Tree::Leaf>> pairs;
+        std::vector<std::string> pathStack;
+        joinPathStack(tree, pairs, pathStack);
+        sink += pairs.size();
+      });
+      auto flatten = [&](std::size_t threads) {
+        return measure(1, [&](std::size_t) { sink += Tree::treeToKeyValues(tree, threads).size(); });
+      };
+
+      print("Joining path stack (ms)", baseline / 1e6);
+      print("Path buffer (ms)", flatten(1) / 1e6);
+      print("Path buffer, " + std::to_string(mThreads) + " threads (ms)", flatten(mThreads) / 1e6);
+      consume(sink);
+    }
+
+    void benchmarkWriters(const Tree::Node& tree)
+    {
+      std::cout << "\n#### Writers\n";
+
+      std::size_t bytes = 0;
+      auto write = [&](const std::function<void(std::ostream&)>& writer) {
+        std::ostringstream stream;
+        auto time = measure(1, [&](std::size_t) { writer(stream); });
+        bytes = stream.str().size();
+        return double(bytes) / (1 << 20) / (time / 1e9);
+      };
+
+      print("printTree (MiB/s)", write([&](std::ostream& stream) { Tree::printTree(tree, stream); }));
+      print("writeJson (MiB/s)", write([&](std::ostream& stream) { Tree::writeJson(tree, stream); }));
+      print("JSON size (MiB)", double(bytes) / (1 << 20));
+      print("writeJson, pretty (MiB/s)", write([&](std::ostream& stream) { Tree::writeJson(tree, stream, true); }));
+      print("writeIni (MiB/s)", write([&](std::ostream& stream) { Tree::writeIni(tree, stream); }));
+    }
+
+    void benchmarkBind(const Tree::Node& tree)
+    {
+      std::cout << "\n#### Binding to structs\n";
+
+      std::vector<const Tree::Node*> links;
+      for (const auto& equipment : Tree::getBranch(tree)) {
+        for (const auto& link : Tree::getBranch(equipment.second, "links")) {
+          if (Tree::getBranch(link.second).size() == 4) {
+            links.push_back(&link.second);
+          }
+        }
+      }
+      if (links.empty()) {
+        return;
+      }
+
+      std::size_t sink = 0;
+      auto getters = measure(mLookups, [&](std::size_t i) {
+        const auto& link = *links[i % links.size()];
+        LinkParameters parameters;
+        parameters.enabled = Tree::getRequired<bool>(link, "enabled");
+        parameters.threshold = Tree::getRequired<int>(link, "threshold");
+        parameters.gain = Tree::getRequired<double>(link, "gain");
+        parameters.name = Tree::getRequired<std::string>(link, "name");
+        sink += parameters.name.size();
+      });
+      auto bind = measure(mLookups, [&](std::size_t i) {
+        sink += Tree::bind<LinkParameters>(*links[i % links.size()]).name.size();
+      });
+
+      print("getRequired per field (ns)", getters);
+      print("Tree::bind (ns)", bind);
+      consume(sink);
+    }
+
+    /// Compares the two containers that can be used for Tree::Branch (see the CONFIGURATION_FLAT_BRANCH CMake option),
+    /// with branch sizes like those of the readout tree: 4 parameters per link, 24 links per equipment, and a root with
+    /// many equipments.
+    void benchmarkBranchContainers()
+    {
+#ifdef CONFIGURATION_FLAT_BRANCH
+      std::cout << "\n#### Branch containers (Tree::Branch is a flat_map in this build)\n";
+#else
+      std::cout << "\n#### Branch containers (Tree::Branch is a std::map in this build)\n";
+#endif
+
+      using StdMap = std::map<std::string, Tree::Leaf, std::less<>>;
+      using FlatMap = boost::container::flat_map<std::string, Tree::Leaf, std::less<>>;
+      std::size_t sink = 0;
+      for (std::size_t branchSize : {std::size_t(4), std::size_t(24), std::size_t(1000)}) {
+        auto map = measureContainer<StdMap>(branchSize, mLeaves, mLookups, sink);
+        auto flat = measureContainer<FlatMap>(branchSize, mLeaves, mLookups, sink);
+        auto label = [&](const std::string& name) { return std::to_string(branchSize) + " children: " + name; };
+        print(label("map build (ns)"), map.build);
+        print(label("flat_map build (ns)"), flat.build);
+        print(label("map iterate (ns)"), map.iterate);
+        print(label("flat_map iterate (ns)"), flat.iterate);
+        print(label("map lookup (ns)"), map.lookup);
+        print(label("flat_map lookup (ns)"), flat.lookup);
+      }
+      consume(sink);
+    }
+
+    /// Compares Tree::Leaf to the boost::variant it replaced, on the leaves of the tree
+    void benchmarkLeaves(const Tree::Node& tree)
+    {
+      std::cout << "\n#### Leaves (Tree::Leaf vs boost::variant)\n";
+
+      // Both are built from fresh values, rather than copying the leaves that share blocks scattered over the tree
+      std::vector<Tree::Leaf> leaves;
+      std::vector<VariantLeaf> variants;
+      for (const auto& leaf : Tree::LeafRange(tree)) {
+        leaves.push_back(Visitor::apply<Tree::Leaf>(leaf.second, [](const auto& value) { return Tree::Leaf(value); }));
+        variants.push_back(Visitor::apply<VariantLeaf>(leaf.second, [](const auto& value) { return VariantLeaf(value); }));
+      }
+
+      std::size_t leafBytes = leaves.size() * sizeof(Tree::Leaf);
+      for (const auto& leaf : leaves) {
+        leafBytes += Tree::heapBytes(leaf);
+      }
+      std::size_t variantBytes = variants.size() * sizeof(VariantLeaf);
+      for (const auto& variant : variants) {
+        if (const auto* string = boost::get<std::string>(&variant)) {
+          variantBytes += Tree::heapBytes(*string);
+        }
+      }
+
+      std::size_t sink = 0;
+      auto copyLeaves = measure(1, [&](std::size_t) { sink += std::vector<Tree::Leaf>(leaves).size(); });
+      auto copyVariants = measure(1, [&](std::size_t) { sink += std::vector<VariantLeaf>(variants).size(); });
+
+      // Get the leaves as their own type, which is what most accesses do
+      auto convertLeaves = measure(1, [&](std::size_t) {
+        for (const auto& leaf : leaves) {
+          switch (leaf.getType()) {
+            case Tree::Leaf::Type::Int:
+              sink += std::size_t(Tree::convert<int>(leaf));
+              break;
+            case Tree::Leaf::Type::Double:
+              sink += std::size_t(Tree::convert<double>(leaf));
+              break;
+            case Tree::Leaf::Type::Bool:
+              sink += std::size_t(Tree::convert<bool>(leaf));
+              break;
+            default:
+              sink += Tree::convert<std::string>(leaf).size();
+          }
+        }
+      });
+      auto convertVariants = measure(1, [&](std::size_t) {
+        for (const auto& variant : variants) {
+          switch (variant.which()) {
+            case 1:
+              sink += std::size_t(convertVariantLeaf<int>(variant));
+              break;
+            case 2:
+              sink += std::size_t(convertVariantLeaf<double>(variant));
+              break;
+            case 3:
+              sink += std::size_t(convertVariantLeaf<bool>(variant));
+              break;
+            default:
+              sink += convertVariantLeaf<std::string>(variant).size();
+          }
+        }
+      });
+
+      double count = double(leaves.size());
+      print("Leaf size (bytes)", sizeof(Tree::Leaf));
+      print("variant size (bytes)", sizeof(VariantLeaf));
+      print("Leaf memory (MiB)", double(leafBytes) / (1 << 20));
+      print("variant memory (MiB)", double(variantBytes) / (1 << 20));
+      print("Leaf copy (ns)", copyLeaves / count);
+      print("variant copy (ns)", copyVariants / count);
+      print("Leaf convert to own type (ns)", convertLeaves / count);
+      print("variant convert to own type (ns)", convertVariants / count);
+      consume(sink);
+    }
+
+    /// Compares getting the startup values of a component one by one and as a batch, from an .ini file
+    void benchmarkGetMany()
+    {
+      std::cout << "\n#### Batched gets (file backend)\n";
+
+      constexpr std::size_t SECTIONS = 1000;
+      constexpr std::size_t BATCH_SIZE = 200;
+      auto file = mBinaryFile + ".ini";
+      {
+        std::ofstream stream(file);
+        for (std::size_t i = 0; i < SECTIONS; ++i) {
+          stream << "[link_" << i << "]\nenabled=1\nthreshold=" << i << "\ngain=1.5\nname=link_name_" << i << '\n';
+        }
+      }
+      auto configuration = AliceO2::Configuration::ConfigurationFactory::getConfiguration("file:/" + file);
+      std::remove(file.c_str());
+
+      std::vector<std::string> paths;
+      std::mt19937 generator(42);
+      for (std::size_t i = 0; i < BATCH_SIZE; ++i) {
+        auto link = "link_" + std::to_string(generator() % SECTIONS);
+        paths.push_back(link + (i % 2 ? "/threshold" : "/name"));
+      }
+
+      std::size_t sink = 0;
+      std::size_t batches = std::max<std::size_t>(mLookups / BATCH_SIZE / 10, 1);
+      auto oneByOne = measure(batches, [&](std::size_t) {
+        for (const auto& path : paths) {
+          sink += configuration->getString(path).get_value_or("").size();
+        }
+      });
+      auto batched = measure(batches, [&](std::size_t) {
+        for (const auto& value : configuration->getMany(paths)) {
+          sink += value.get_value_or("").size();
+        }
+      });
+
+      print("getString() x " + std::to_string(BATCH_SIZE) + " (us)", oneByOne / 1e3);
+      print("getMany() of " + std::to_string(BATCH_SIZE) + " (us)", batched / 1e3);
+      consume(sink);
+    }
+
+    /// Compares repeated gets from the file backend with and without a cache in front of it. The file backend is in
+    /// memory, so this shows the overhead of a hit rather than the round trips a cache saves on a remote backend.
+    void benchmarkCaching()
+    {
+      std::cout << "\n#### Cached gets (file backend)\n";
+
+      constexpr std::size_t SECTIONS = 1000;
+      auto file = mBinaryFile + ".ini";
+      {
+        std::ofstream stream(file);
+        for (std::size_t i = 0; i < SECTIONS; ++i) {
+          stream << "[link_" << i << "]\nenabled=1\nthreshold=" << i << "\ngain=1.5\nname=link_name_" << i << '\n';
+        }
+      }
+      auto uncached = AliceO2::Configuration::ConfigurationFactory::getConfiguration("file:/" + file);
+      auto cached = AliceO2::Configuration::ConfigurationFactory::getConfiguration("cache+file:/" + file + "?ttl=0s");
+      std::remove(file.c_str());
+
+      std::vector<std::string> paths;
+      std::mt19937 generator(42);
+      for (std::size_t i = 0; i < SECTIONS; ++i) {
+        auto link = "link_" + std::to_string(generator() % SECTIONS);
+        paths.push_back(link + (i % 3 ? "/threshold" : "/threshold_override"));
+      }
+
+      std::size_t sink = 0;
+      auto uncachedGet = measure(mLookups, [&](std::size_t i) {
+        sink += uncached->getString(paths[i % paths.size()]).get_value_or("").size();
+      });
+      auto cachedGet = measure(mLookups, [&](std::size_t i) {
+        sink += cached->getString(paths[i % paths.size()]).get_value_or("").size();
+      });
+      auto stats = dynamic_cast<Backends::CachingBackend&>(*cached).getStats();
+
+      print("Uncached getString() (ns)", uncachedGet);
+      print("Cached getString() (ns)", cachedGet);
+      print("Hit rate (%)", 100.0 * double(stats.hits) / double(stats.hits + stats.misses));
+      print("Cache memory (KiB, estimate)", double(stats.bytes) / 1024);
+      consume(sink);
+    }
+
+    /// Compares lookups from many threads while another thread reloads the configuration every millisecond: through
+    /// snapshots, and through a tree guarded by a mutex
+    void benchmarkSnapshots(const Tree::Node& tree, const std::vector<std::string>& paths)
+    {
+      std::size_t threads = std::max<std::size_t>(mThreads, 1);
+      std::cout << "\n#### Snapshots (" << threads << " reader threads, reloading meanwhile)\n";
+
+      TreeBackend backend(tree);
+      backend.snapshot();
+      Tree::Node guarded = tree;
+      std::mutex mutex;
+
+      std::atomic<bool> done(false);
+      std::size_t reloads = 0;
+      std::thread reloader([&] {
+        while (!done) {
+          backend.reload();
+          Tree::Node copy = tree;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(guarded, copy);
+          }
+          reloads++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      });
+
+      constexpr std::size_t LOOKUPS_PER_SNAPSHOT = 1000;
+      std::size_t iterations = std::max<std::size_t>(mLookups / threads, 1);
+      std::atomic<std::size_t> sink(0);
+      auto snapshotPerLookup = measureParallel(threads, iterations, [&](std::size_t i) {
+        return std::size_t(Tree::find(backend.snapshot()->tree(), paths[i % paths.size()]) != nullptr);
+      }, sink);
+      auto snapshotPerBatch = measureParallel(threads, iterations / LOOKUPS_PER_SNAPSHOT + 1, [&](std::size_t i) {
+        auto snapshot = backend.snapshot();
+        std::size_t found = 0;
+        for (std::size_t j = 0; j < LOOKUPS_PER_SNAPSHOT; ++j) {
+          found += std::size_t(Tree::find(snapshot->tree(), paths[(i * LOOKUPS_PER_SNAPSHOT + j) % paths.size()])
+              != nullptr);
+        }
+        return found;
+      }, sink) / LOOKUPS_PER_SNAPSHOT;
+      auto locked = measureParallel(threads, iterations, [&](std::size_t i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::size_t(Tree::find(guarded, paths[i % paths.size()]) != nullptr);
+      }, sink);
+      done = true;
+      reloader.join();
+
+      print("Snapshot per lookup (ns)", snapshotPerLookup);
+      print("Snapshot per 1000 lookups (ns)", snapshotPerBatch);
+      print("Mutex per lookup (ns)", locked);
+      print("Reloads", double(reloads));
+      consume(sink);
+    }
+
+    void print(const std::string& label, double value)
+    {
+      std::cout << "  " << std::left << std::setw(36) << label << std::fixed << std::setprecision(2) << value << '\n';
+    }
+
+    /// Makes sure the compiler cannot optimize away the benchmarked work
+    void consume(std::size_t sink)
+    {
+      if (isVerbose()) {
+        std::cout << "  (checksum " << sink << ")\n";
+      }
+    }
+
+    std::size_t mLeaves;
+    std::size_t mLookups;
+    std::size_t mThreads;
+    std::string mBinaryFile;
+};
+} // Anonymous namespace
+
+int main(int argc, char** argv)
+{
+  return Benchmark().execute(argc, argv);
+}
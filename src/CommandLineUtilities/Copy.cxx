@@ -6,6 +6,8 @@
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 #include "Program.h"
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/Tree.h"
@@ -25,7 +27,8 @@ class Copy : public AliceO2::Configuration::Program
     {
       optionsDescription.add_options()
           ("source,s", po::value<std::string>(&mSourceUri)->required(), "Source server URI")
-          ("dest,d", po::value<std::string>(&mDestinationUri)->required(), "Destination server URI");
+          ("dest,d", po::value<std::string>(&mDestinationUri)->required(), "Destination server URI")
+          ("atomic,a", po::bool_switch(&mAtomic), "Copy all values or none, if the destination supports it");
     }
 
     virtual void run(const boost::program_options::variables_map& variablesMap) override
@@ -33,27 +36,26 @@ class Copy : public AliceO2::Configuration::Program
       using namespace AliceO2::Configuration;
       auto source = ConfigurationFactory::getConfiguration(mSourceUri);
       auto destination = ConfigurationFactory::getConfiguration(mDestinationUri);
-      auto keyValues = Tree::treeToKeyValues(source->getRecursive("/"));
+      auto tree = source->getRecursiveShared("/");
 
-      if (isVerbose()) {
-        std::cout << "Got " << keyValues.size() << " key-value pairs\n";
-      }
-
-      for (const auto& kv : keyValues) {
+      std::vector<std::pair<std::string, Tree::Leaf>> pairs;
+      for (const auto& kv : Tree::LeafRange(*tree)) {
+        pairs.emplace_back(kv.first.to_string(), kv.second);
         if (isVerbose()) {
-          std::cout << kv.first << " -> " << kv.second << '\n';
+          std::cout << pairs.back().first << " -> " << kv.second << '\n';
         }
+      }
+
+      destination->putMany(pairs, mAtomic);
 
-        Visitor::apply(kv.second,
-            [&](const std::string& value) { destination->put<std::string>(kv.first, value); },
-            [&](int value) { destination->put<int>(kv.first, value); },
-            [&](bool value) { destination->put<int>(kv.first, int(value)); },
-            [&](double value) { destination->put<double>(kv.first, value); });
+      if (isVerbose()) {
+        std::cout << "Copied " << pairs.size() << " key-value pairs\n";
       }
     }
 
     std::string mSourceUri;
     std::string mDestinationUri;
+    bool mAtomic = false;
 };
 } // Anonymous namespace
 
@@ -5,9 +5,11 @@
 
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include "Program.h"
 #include "Configuration/ConfigurationFactory.h"
+#include "Configuration/TreeWriter.h"
 
 namespace po = boost::program_options;
 namespace
@@ -25,14 +27,27 @@ class Get : public AliceO2::Configuration::Program
       optionsDescription.add_options()
           ("uri", po::value<std::string>(&mServerUri)->required(), "Server URI")
           ("key,k", po::value<std::string>(&mKey)->required(), "Key to get value with")
-          ("recursive,r", po::bool_switch(&mRecursive), "Recursive get");
+          ("recursive,r", po::bool_switch(&mRecursive), "Recursive get")
+          ("format,f", po::value<std::string>(&mFormat)->default_value("tree"),
+              "Output format of a recursive get: 'tree', 'json' or 'ini'")
+          ("pretty,p", po::bool_switch(&mPretty), "Pretty-print the JSON or INI output");
     }
 
     virtual void run(const boost::program_options::variables_map& variablesMap) override
     {
       auto configuration = AliceO2::Configuration::ConfigurationFactory::getConfiguration(mServerUri);
       if (mRecursive) {
-        AliceO2::Configuration::Tree::printTree(configuration->getRecursive(mKey), std::cout);
+        using namespace AliceO2::Configuration;
+        auto tree = configuration->getRecursiveShared(mKey);
+        if (mFormat == "json") {
+          Tree::writeJson(*tree, std::cout, mPretty);
+        } else if (mFormat == "ini") {
+          Tree::writeIni(*tree, std::cout, mPretty);
+        } else if (mFormat == "tree") {
+          Tree::printTree(*tree, std::cout);
+        } else {
+          throw std::runtime_error("Unknown format '" + mFormat + "'");
+        }
       } else {
         std::cout << configuration->getString(mKey).value_or("Key did not exist") << '\n';
       }
@@ -41,6 +56,8 @@ class Get : public AliceO2::Configuration::Program
     std::string mServerUri;
     std::string mKey;
     bool mRecursive;
+    std::string mFormat;
+    bool mPretty;
 };
 } // Anonymous namespace
 
@@ -4,8 +4,14 @@
 /// \author Pascal Boeschoten, CERN
 
 #include <src/Backends/File/FileBackend.h>
+#include <chrono>
 #include <functional>
 #include <stdexcept>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+#include "Configuration/CachingBackend.h"
 #include "Configuration/ConfigurationFactory.h"
 #ifdef FLP_CONFIGURATION_BACKEND_FILE_JSON_ENABLED
 # include "Backends/Json/JsonBackend.h"
@@ -23,6 +29,52 @@ namespace
 {
 using UniqueConfiguration = std::unique_ptr<ConfigurationInterface>;
 
+/// Gets the value of a parameter from the query part of the URI, the part after the '?'
+auto getQueryParameter(const http::url& uri, const std::string& name) -> boost::optional<std::string>
+{
+  std::vector<std::string> parameters;
+  boost::split(parameters, uri.search, boost::is_any_of("&"));
+  for (const auto& parameter : parameters) {
+    if (boost::starts_with(parameter, name + "=")) {
+      return parameter.substr(name.size() + 1);
+    }
+  }
+  return boost::none;
+}
+
+/// Gets a parameter that is a count or a size
+/// \throw std::runtime_error if it is not a non-negative integer
+auto getSizeParameter(const http::url& uri, const std::string& name) -> boost::optional<std::size_t>
+{
+  auto parameter = getQueryParameter(uri, name);
+  if (!parameter) {
+    return boost::none;
+  }
+  std::size_t value;
+  if (parameter->empty() || (*parameter)[0] == '-' || !boost::conversion::try_lexical_convert(*parameter, value)) {
+    throw std::runtime_error("Invalid value '" + *parameter + "' of URI parameter '" + name + "', expected a size");
+  }
+  return value;
+}
+
+/// Gets a parameter that is a flag, given as true, false, 1 or 0
+/// \throw std::runtime_error if it is none of those
+auto getBoolParameter(const http::url& uri, const std::string& name) -> boost::optional<bool>
+{
+  auto parameter = getQueryParameter(uri, name);
+  if (!parameter) {
+    return boost::none;
+  }
+  if (*parameter == "true" || *parameter == "1") {
+    return true;
+  }
+  if (*parameter == "false" || *parameter == "0") {
+    return false;
+  }
+  throw std::runtime_error("Invalid value '" + *parameter + "' of URI parameter '" + name
+      + "', expected true, false, 1 or 0");
+}
+
 auto getFile(const http::url& uri) -> UniqueConfiguration
 {
   // If the "authority" part of the URI is missing (host, port, etc), the parser
@@ -48,7 +100,11 @@ auto getJson(const http::url& uri) -> UniqueConfiguration
 auto getConsul(const http::url& uri) -> UniqueConfiguration
 {
 #ifdef FLP_CONFIGURATION_BACKEND_CONSUL_ENABLED
-  auto consul = std::make_unique<Backends::ConsulBackend>(uri.host, uri.port);
+  auto ioThreads = Backends::ConsulBackend::DEFAULT_IO_THREADS;
+  if (auto parameter = getSizeParameter(uri, "io_threads")) {
+    ioThreads = *parameter;
+  }
+  auto consul = std::make_unique<Backends::ConsulBackend>(uri.host, uri.port, ioThreads);
   if (!uri.path.empty()) {
     consul->setPrefix(uri.path);
   }
@@ -57,6 +113,47 @@ auto getConsul(const http::url& uri) -> UniqueConfiguration
   throw std::runtime_error("Back-end 'consul' not enabled");
 #endif
 }
+
+/// Parses a duration with a unit of ms, s or m. A number without unit is in seconds.
+auto parseDuration(const std::string& string) -> std::chrono::milliseconds
+{
+  auto unitStart = string.find_first_not_of("0123456789");
+  long long amount = 0;
+  auto unit = unitStart == std::string::npos ? std::string("s") : string.substr(unitStart);
+  if (!boost::conversion::try_lexical_convert(string.substr(0, unitStart), amount)) {
+    unit.clear();
+  }
+  if (unit == "ms") {
+    return std::chrono::milliseconds(amount);
+  } else if (unit == "s") {
+    return std::chrono::seconds(amount);
+  } else if (unit == "m") {
+    return std::chrono::minutes(amount);
+  }
+  throw std::runtime_error("Invalid duration '" + string + "', expected a number with a unit of ms, s or m");
+}
+
+/// Wraps the backend in a cache, with the bounds given in the query part of the URI
+auto getCaching(const http::url& uri, UniqueConfiguration backend) -> UniqueConfiguration
+{
+  Backends::CachingBackend::Parameters parameters;
+  if (auto parameter = getQueryParameter(uri, "ttl")) {
+    parameters.ttl = parseDuration(*parameter);
+  }
+  if (auto parameter = getSizeParameter(uri, "max")) {
+    parameters.maxEntries = *parameter;
+  }
+  if (auto parameter = getSizeParameter(uri, "max_bytes")) {
+    parameters.maxBytes = *parameter;
+  }
+  if (auto parameter = getSizeParameter(uri, "shards")) {
+    parameters.shards = *parameter;
+  }
+  if (auto parameter = getBoolParameter(uri, "cache_missing")) {
+    parameters.cacheMissing = *parameter;
+  }
+  return std::make_unique<Backends::CachingBackend>(std::move(backend), parameters);
+}
 } // Anonymous namespace
 
 auto ConfigurationFactory::getConfiguration(const std::string& uri) -> UniqueConfiguration
@@ -68,6 +165,12 @@ auto ConfigurationFactory::getConfiguration(const std::string& uri) -> UniqueCon
     throw std::runtime_error("Ill-formed URI");
   }
 
+  // "cache+<uri>" wraps the backend of the rest of the URI in a cache
+  const std::string cachePrefix = "cache+";
+  if (boost::starts_with(parsedUrl.protocol, cachePrefix)) {
+    return getCaching(parsedUrl, getConfiguration(uri.substr(cachePrefix.size())));
+  }
+
   static const std::map<std::string, std::function<UniqueConfiguration(const http::url&)>> map = {
       {"file", getFile},
       {"json", getJson},
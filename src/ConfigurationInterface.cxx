@@ -4,7 +4,10 @@
 /// \author Pascal Boeschoten, CERN
 
 #include "Configuration/ConfigurationInterface.h"
+#include <functional>
+#include <future>
 #include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
 
 namespace AliceO2
 {
@@ -16,6 +19,19 @@ ConfigurationInterface::~ConfigurationInterface()
 {
 }
 
+Watch::~Watch()
+{
+}
+
+std::exception_ptr Watch::callbackError() const
+{
+  return nullptr;
+}
+
+ConfigurationInterface::Path::Path(const std::string& path) : mPath(path), mHash(std::hash<std::string>()(path))
+{
+}
+
 /// Converts a boost::optional of one type to another by using boost::lexical_cast.
 template <typename Out, typename OptionalIn>
 boost::optional<Out> convertOptional(const OptionalIn& in)
@@ -27,6 +43,39 @@ boost::optional<Out> convertOptional(const OptionalIn& in)
   }
 }
 
+/// Converts a boost::optional string to a Result of another type, without throwing
+template <typename Out>
+Result<Out> convertResult(const boost::optional<std::string>& in)
+{
+  if (!in) {
+    return LookupError::NotFound;
+  }
+  Out out;
+  if (!boost::conversion::try_lexical_convert(in.value(), out)) {
+    return LookupError::ConversionFailed;
+  }
+  return out;
+}
+
+template <>
+Result<std::string> convertResult(const boost::optional<std::string>& in)
+{
+  if (!in) {
+    return LookupError::NotFound;
+  }
+  return in.value();
+}
+
+/// Runs a function on the calling thread, and returns a ready future of its result or exception
+template <typename Function>
+auto runNow(Function function) -> std::future<decltype(function())>
+{
+  std::packaged_task<decltype(function())()> task(std::move(function));
+  auto future = task.get_future();
+  task();
+  return future;
+}
+
 // Default implementations of non-string puts/gets, that use putString() and
 // getString() + a lexical_cast
 
@@ -40,6 +89,70 @@ void ConfigurationInterface::putFloat(const std::string& path, double value)
   putString(path, boost::lexical_cast<std::string>(value));
 }
 
+void ConfigurationInterface::putMany(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs, bool atomic)
+{
+  if (atomic && pairs.size() > 1) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Atomic putMany() unsupported by backend"));
+  }
+  for (const auto& pair : pairs) {
+    const auto& path = pair.first;
+    Visitor::apply(pair.second,
+        [&](const std::string& value) { putString(path, value); },
+        [&](int value) { putInt(path, value); },
+        [&](bool value) { putInt(path, int(value)); },
+        [&](double value) { putFloat(path, value); },
+        [&](const Tree::DoubleArray&) { putString(path, Tree::convert<std::string>(pair.second)); },
+        [&](const Tree::IntArray&) { putString(path, Tree::convert<std::string>(pair.second)); });
+  }
+}
+
+auto ConfigurationInterface::getStringAsync(const std::string& path) -> std::future<Optional<std::string>>
+{
+  return runNow([&] { return getString(path); });
+}
+
+auto ConfigurationInterface::putStringAsync(const std::string& path, const std::string& value) -> std::future<void>
+{
+  return runNow([&] { putString(path, value); });
+}
+
+auto ConfigurationInterface::getRecursiveAsync(const std::string& path) -> std::future<Tree::Node>
+{
+  return runNow([&] { return getRecursive(path); });
+}
+
+auto ConfigurationInterface::watch(const std::string&, WatchCallback) -> std::unique_ptr<Watch>
+{
+  BOOST_THROW_EXCEPTION(std::runtime_error("Backend does not support watching values"));
+}
+
+auto ConfigurationInterface::snapshot() -> std::shared_ptr<const Snapshot>
+{
+  if (auto current = std::atomic_load(&mSnapshot)) {
+    return current;
+  }
+  return loadIfEmpty();
+}
+
+auto ConfigurationInterface::loadIfEmpty() -> std::shared_ptr<const Snapshot>
+{
+  // Threads getting the first snapshot at the same time wait for the first of them to load it
+  std::lock_guard<std::recursive_mutex> lock(mReloadMutex);
+  if (auto current = std::atomic_load(&mSnapshot)) {
+    return current;
+  }
+  return reload();
+}
+
+auto ConfigurationInterface::reload() -> std::shared_ptr<const Snapshot>
+{
+  std::lock_guard<std::recursive_mutex> lock(mReloadMutex);
+  auto previous = std::atomic_load(&mSnapshot);
+  auto loaded = std::make_shared<const Snapshot>(getRecursiveShared(""), previous ? previous->version() + 1 : 1);
+  std::atomic_store(&mSnapshot, loaded);
+  return loaded;
+}
+
 auto ConfigurationInterface::getInt(const std::string& path) -> Optional<int>
 {
   return convertOptional<int>(getString(path));
@@ -50,12 +163,42 @@ auto ConfigurationInterface::getFloat(const std::string& path) -> Optional<doubl
   return convertOptional<double>(getString(path));
 }
 
+auto ConfigurationInterface::getString(const Path& path) -> Optional<std::string>
+{
+  return getString(path.string());
+}
+
+auto ConfigurationInterface::getMany(const std::vector<std::string>& paths) -> std::vector<Optional<std::string>>
+{
+  std::vector<Optional<std::string>> values;
+  values.reserve(paths.size());
+  for (const auto& path : paths) {
+    values.push_back(getString(path));
+  }
+  return values;
+}
+
 // Default implementation of exists()
 bool ConfigurationInterface::exists(const std::string& path)
 {
   return getString(path).is_initialized();
 }
 
+bool ConfigurationInterface::exists(const Path& path)
+{
+  return getString(path).is_initialized();
+}
+
+auto ConfigurationInterface::getRecursiveShared(const std::string& path) -> Tree::SharedNode
+{
+  return Tree::SharedNode(getRecursive(path));
+}
+
+auto ConfigurationInterface::memoryUsage() const -> std::size_t
+{
+  return 0;
+}
+
 // Template specializations of the convenience interface methods put/get
 
 template<> void ConfigurationInterface::put(const std::string& path, const std::string& value)
@@ -88,5 +231,50 @@ template<> auto ConfigurationInterface::get(const std::string& path) -> Optional
   return getFloat(path);
 }
 
+template<> auto ConfigurationInterface::get(const Path& path) -> Optional<std::string>
+{
+  return getString(path);
+}
+
+template<> auto ConfigurationInterface::get(const Path& path) -> Optional<int>
+{
+  return convertOptional<int>(getString(path));
+}
+
+template<> auto ConfigurationInterface::get(const Path& path) -> Optional<double>
+{
+  return convertOptional<double>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const std::string& path) -> Result<std::string>
+{
+  return convertResult<std::string>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const std::string& path) -> Result<int>
+{
+  return convertResult<int>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const std::string& path) -> Result<double>
+{
+  return convertResult<double>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const Path& path) -> Result<std::string>
+{
+  return convertResult<std::string>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const Path& path) -> Result<int>
+{
+  return convertResult<int>(getString(path));
+}
+
+template<> auto ConfigurationInterface::tryGet(const Path& path) -> Result<double>
+{
+  return convertResult<double>(getString(path));
+}
+
 } // namespace Configuration
 } // namespace AliceO2
@@ -0,0 +1,479 @@
+/// \file FlatTree.cxx
+/// \brief Implementation of the FlatTree, a compact immutable representation of a Tree::Node
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/FlatTree.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/throw_exception.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Checks that a size or offset fits in the 32-bit fields of an Entry
+std::uint32_t checkedSize(std::size_t size)
+{
+  if (size > std::numeric_limits<std::uint32_t>::max()) {
+    BOOST_THROW_EXCEPTION(std::length_error("Tree too large to be flattened"));
+  }
+  return std::uint32_t(size);
+}
+
+/// Storage of a tree built in memory
+struct OwnedStorage
+{
+    std::vector<FlatTree::Entry> entries;
+    std::vector<char, boost::alignment::aligned_allocator<char, ARRAY_ALIGNMENT>> strings;
+};
+
+/// Storage of a tree mapped from a file
+class MappedFile
+{
+  public:
+    MappedFile(void* address, std::size_t size) : mAddress(address), mSize(size)
+    {
+    }
+
+    ~MappedFile()
+    {
+      ::munmap(mAddress, mSize);
+    }
+
+  private:
+    void* mAddress;
+    std::size_t mSize;
+};
+
+constexpr char FILE_MAGIC[8] = {'O', '2', 'C', 'F', 'T', 'R', 'E', 'E'};
+constexpr std::uint32_t FILE_VERSION = 2;
+constexpr std::uint32_t FILE_BYTE_ORDER = 0x01020304;
+
+/// Header of the binary file format
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder; ///< FILE_BYTE_ORDER as written by the writer, to detect a different byte order
+    std::uint32_t entrySize; ///< sizeof(Entry), to detect a different layout
+    std::uint32_t reserved;
+    std::uint64_t entryCount;
+    std::uint64_t stringsSize;
+    std::uint64_t entriesOffset;
+    std::uint64_t stringsOffset;
+    std::uint64_t checksum; ///< Of the node array followed by the string arena
+};
+
+static_assert(sizeof(FlatTree::Entry) == 32, "The Entry layout is part of the file format");
+static_assert(sizeof(FileHeader) % alignof(FlatTree::Entry) == 0, "Entries following the header must be aligned");
+
+/// Offset of the string arena in a file, following the node array
+auto alignedStringsOffset(std::size_t entriesEnd) -> std::size_t
+{
+  return (entriesEnd + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+}
+
+auto checksum(const FlatTree::Entry* entries, std::size_t entryCount, const char* strings, std::size_t stringsSize)
+    -> Hash
+{
+  auto entriesHash = HashImplementation::hashBytes(entries, entryCount * sizeof(FlatTree::Entry));
+  auto stringsHash = HashImplementation::hashBytes(strings, stringsSize);
+  return HashImplementation::addChild(entriesHash, boost::string_view(), stringsHash);
+}
+
+/// Checks that every entry of a mapped file only refers to entries and strings inside the mapping, so that a corrupted
+/// file cannot lead to out-of-bounds reads. Children must come after their parent, which also rules out cycles.
+auto validEntries(const FlatTree::Entry* entries, std::size_t entryCount, std::size_t stringsSize) -> bool
+{
+  using Type = FlatTree::Type;
+  auto inStrings = [&](std::uint64_t offset, std::uint64_t size) {
+    return offset <= stringsSize && size <= stringsSize - offset;
+  };
+  auto validArray = [&](const FlatTree::Entry& entry, std::size_t elementSize) {
+    return entry.value.offset % ARRAY_ALIGNMENT == 0
+      && inStrings(entry.value.offset, std::uint64_t(entry.size) * elementSize);
+  };
+
+  for (std::size_t i = 0; i < entryCount; ++i) {
+    const auto& entry = entries[i];
+    if (!inStrings(entry.keyOffset, entry.keyLength)) {
+      return false;
+    }
+    bool valid = false;
+    switch (entry.type) {
+      case Type::Branch:
+        valid = entry.value.offset > i && entry.value.offset <= entryCount
+          && entry.size <= entryCount - entry.value.offset;
+        break;
+      case Type::String:
+        valid = inStrings(entry.value.offset, entry.size);
+        break;
+      case Type::Int:
+      case Type::Double:
+      case Type::Bool:
+        valid = true;
+        break;
+      case Type::DoubleArray:
+        valid = validArray(entry, sizeof(double));
+        break;
+      case Type::IntArray:
+        valid = validArray(entry, sizeof(std::int64_t));
+        break;
+    }
+    if (!valid) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Writes all of a buffer to a file descriptor, retrying short writes
+auto writeAll(int descriptor, const void* data, std::size_t size) -> bool
+{
+  const auto* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    auto written = ::write(descriptor, bytes, size);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += written;
+    size -= std::size_t(written);
+  }
+  return true;
+}
+} // Anonymous namespace
+
+FlatTree::FlatTree() : FlatTree(Branch())
+{
+}
+
+FlatTree::FlatTree(const Node& tree)
+{
+  auto storage = std::make_shared<OwnedStorage>();
+  auto& entries = storage->entries;
+  auto& strings = storage->strings;
+
+  // Nodes that still need their children added, in the same order as entries
+  std::vector<const Node*> nodes;
+
+  auto addString = [&](const std::string& string) {
+    auto offset = checkedSize(strings.size());
+    strings.insert(strings.end(), string.begin(), string.end());
+    return offset;
+  };
+
+  auto addArray = [&](const auto& array) {
+    // Keep the elements as aligned as they are in the Array
+    strings.resize((strings.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT, '\0');
+    auto offset = strings.size();
+    const auto* bytes = reinterpret_cast<const char*>(array.data());
+    strings.insert(strings.end(), bytes, bytes + array.size() * sizeof(*array.data()));
+    return offset;
+  };
+
+  auto addEntry = [&](const std::string& key, const Node& node) {
+    Entry entry;
+    entry.keyOffset = addString(key);
+    entry.keyLength = checkedSize(key.size());
+    entry.size = 0;
+    entry.value.offset = 0;
+    entry.hash = 0;
+    Visitor::apply(node,
+        [&](const Branch&) {
+          entry.type = Type::Branch;
+        },
+        [&](const Leaf& leaf) {
+          entry.hash = hash(leaf);
+          Visitor::apply(leaf,
+              [&](const std::string& value) {
+                entry.type = Type::String;
+                entry.size = checkedSize(value.size());
+                entry.value.offset = addString(value);
+              },
+              [&](int value) {
+                entry.type = Type::Int;
+                entry.value.integer = value;
+              },
+              [&](bool value) {
+                entry.type = Type::Bool;
+                entry.value.boolean = value ? 1 : 0;
+              },
+              [&](double value) {
+                entry.type = Type::Double;
+                entry.value.floating = value;
+              },
+              [&](const DoubleArray& value) {
+                entry.type = Type::DoubleArray;
+                entry.size = checkedSize(value.size());
+                entry.value.offset = addArray(value);
+              },
+              [&](const IntArray& value) {
+                entry.type = Type::IntArray;
+                entry.size = checkedSize(value.size());
+                entry.value.offset = addArray(value);
+              });
+        });
+    entries.push_back(entry);
+    nodes.push_back(&node);
+  };
+
+  // Breadth-first, so that the children of every branch end up next to each other
+  addEntry(std::string(), tree);
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    if (const auto* branch = boost::get<Branch>(nodes[i])) {
+      entries[i].size = checkedSize(branch->size());
+      entries[i].value.offset = entries.size();
+      // std::map is sorted, so the children are added in the order binary search expects
+      for (const auto& keyValuePair : *branch) {
+        addEntry(keyValuePair.first, keyValuePair.second);
+      }
+    }
+  }
+
+  // Children always come after their parent, so going backwards, the children's hashes are known before their parent's
+  for (auto i = entries.size(); i-- > 0;) {
+    if (entries[i].type == Type::Branch) {
+      Hash branchHash = HashImplementation::branchSeed();
+      for (std::size_t c = 0; c < entries[i].size; ++c) {
+        const Entry& child = entries[entries[i].value.offset + c];
+        auto key = boost::string_view(strings.data() + child.keyOffset, child.keyLength);
+        branchHash = HashImplementation::addChild(branchHash, key, child.hash);
+      }
+      entries[i].hash = branchHash;
+    }
+  }
+
+  entries.shrink_to_fit();
+  strings.shrink_to_fit();
+
+  mEntries = entries.data();
+  mEntryCount = entries.size();
+  mStrings = strings.data();
+  mStringsSize = strings.size();
+  mStorage = std::move(storage);
+}
+
+void FlatTree::writeFile(const std::string& filePath) const
+{
+  FileHeader header;
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+  header.version = FILE_VERSION;
+  header.byteOrder = FILE_BYTE_ORDER;
+  header.entrySize = sizeof(Entry);
+  header.reserved = 0;
+  header.entryCount = mEntryCount;
+  header.stringsSize = mStringsSize;
+  header.entriesOffset = sizeof(FileHeader);
+  header.stringsOffset = alignedStringsOffset(header.entriesOffset + mEntryCount * sizeof(Entry));
+  header.checksum = checksum(mEntries, mEntryCount, mStrings, mStringsSize);
+
+  // Rewriting the file in place would change the pages of processes that have it mapped, and truncating it would make
+  // them crash on access. Instead, the new contents go to a temporary file that atomically replaces the old one, so
+  // existing mappings keep the old file and new ones see either version in full.
+  auto fail = [&](const std::string& reason) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to write tree to file '" + filePath + "': " + reason));
+  };
+
+  std::string temporaryPath = filePath + ".XXXXXX";
+  int descriptor = ::mkstemp(&temporaryPath[0]);
+  if (descriptor == -1) {
+    fail(std::strerror(errno));
+  }
+
+  std::string padding(header.stringsOffset - header.entriesOffset - mEntryCount * sizeof(Entry), '\0');
+  bool written = ::fchmod(descriptor, 0644) == 0
+    && writeAll(descriptor, &header, sizeof(header))
+    && writeAll(descriptor, mEntries, mEntryCount * sizeof(Entry))
+    && writeAll(descriptor, padding.data(), padding.size())
+    && writeAll(descriptor, mStrings, mStringsSize)
+    && ::fsync(descriptor) == 0;
+  auto error = errno;
+  if (::close(descriptor) == -1 && written) {
+    written = false;
+    error = errno;
+  }
+  if (!written || ::rename(temporaryPath.c_str(), filePath.c_str()) == -1) {
+    if (written) {
+      error = errno;
+    }
+    ::unlink(temporaryPath.c_str());
+    fail(std::strerror(error));
+  }
+}
+
+auto FlatTree::mapFile(const std::string& filePath, bool verifyChecksum) -> FlatTree
+{
+  auto fail = [&](const std::string& reason) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Failed to map tree file '" + filePath + "': " + reason));
+  };
+
+  int descriptor = ::open(filePath.c_str(), O_RDONLY);
+  if (descriptor == -1) {
+    fail(std::strerror(errno));
+  }
+  struct stat status;
+  if (::fstat(descriptor, &status) == -1) {
+    auto error = errno;
+    ::close(descriptor);
+    fail(std::strerror(error));
+  }
+  auto size = std::size_t(status.st_size);
+  if (size < sizeof(FileHeader)) {
+    ::close(descriptor);
+    fail("file too small");
+  }
+  void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+  auto error = errno;
+  // The mapping stays valid after the file is closed
+  ::close(descriptor);
+  if (address == MAP_FAILED) {
+    fail(std::strerror(error));
+  }
+  auto mapping = std::make_shared<MappedFile>(address, size);
+
+  const auto* bytes = static_cast<const char*>(address);
+  FileHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0) {
+    fail("not a tree file");
+  }
+  if (header.version != FILE_VERSION) {
+    fail("unsupported format version " + std::to_string(header.version));
+  }
+  if (header.byteOrder != FILE_BYTE_ORDER || header.entrySize != sizeof(Entry)) {
+    fail("written on an incompatible architecture");
+  }
+  if (header.entryCount == 0 || header.entriesOffset % alignof(Entry) != 0
+      || header.entriesOffset > size || header.entryCount > (size - header.entriesOffset) / sizeof(Entry)
+      || header.stringsOffset % ARRAY_ALIGNMENT != 0
+      || header.stringsOffset > size || header.stringsSize > size - header.stringsOffset) {
+    fail("corrupted header");
+  }
+  const auto* entries = reinterpret_cast<const Entry*>(bytes + header.entriesOffset);
+  if (!validEntries(entries, header.entryCount, header.stringsSize)) {
+    fail("corrupted entries");
+  }
+
+  FlatTree tree;
+  tree.mEntries = entries;
+  tree.mEntryCount = header.entryCount;
+  tree.mStrings = bytes + header.stringsOffset;
+  tree.mStringsSize = header.stringsSize;
+  tree.mStorage = std::move(mapping);
+
+  if (verifyChecksum
+      && checksum(tree.mEntries, tree.mEntryCount, tree.mStrings, tree.mStringsSize) != header.checksum) {
+    fail("checksum mismatch");
+  }
+  return tree;
+}
+
+auto FlatTree::Reference::key() const -> boost::string_view
+{
+  return mTree->getString(entry().keyOffset, entry().keyLength);
+}
+
+auto FlatTree::Reference::child(std::size_t index) const -> Reference
+{
+  return Reference(mTree, std::uint32_t(entry().value.offset + index));
+}
+
+auto FlatTree::Reference::find(boost::string_view key) const -> Reference
+{
+  if (!isBranch()) {
+    return {};
+  }
+
+  const Entry* first = mTree->mEntries + entry().value.offset;
+  const Entry* last = first + entry().size;
+  const FlatTree* tree = mTree;
+  const Entry* found = std::lower_bound(first, last, key, [tree](const Entry& entry, boost::string_view key) {
+    return tree->getString(entry.keyOffset, entry.keyLength) < key;
+  });
+
+  if (found != last && mTree->getString(found->keyOffset, found->keyLength) == key) {
+    return Reference(mTree, std::uint32_t(found - mTree->mEntries));
+  }
+  return {};
+}
+
+auto FlatTree::Reference::getSubtree(boost::string_view path) const -> Reference
+{
+  Reference reference = *this;
+  for (const auto& segment : PathSegments(path)) {
+    reference = reference.find(segment);
+    if (!reference) {
+      break;
+    }
+  }
+  return reference;
+}
+
+auto FlatTree::Reference::getStringView() const -> boost::string_view
+{
+  if (type() != Type::String) {
+    return {};
+  }
+  return mTree->getString(entry().value.offset, entry().size);
+}
+
+auto FlatTree::Reference::getLeaf() const -> Leaf
+{
+  const Entry& e = entry();
+  switch (e.type) {
+    case Type::String:
+      return getStringView().to_string();
+    case Type::Int:
+      return int(e.value.integer);
+    case Type::Double:
+      return e.value.floating;
+    case Type::Bool:
+      return e.value.boolean != 0;
+    case Type::DoubleArray: {
+      auto view = getArray<double>();
+      return DoubleArray(view.begin(), view.end());
+    }
+    case Type::IntArray: {
+      auto view = getArray<std::int64_t>();
+      return IntArray(view.begin(), view.end());
+    }
+    case Type::Branch:
+      break;
+  }
+  BOOST_THROW_EXCEPTION(std::logic_error("FlatTree entry is not a leaf"));
+}
+
+auto FlatTree::Reference::toNode() const -> Node
+{
+  if (isLeaf()) {
+    return getLeaf();
+  }
+
+  Branch branch;
+  for (std::size_t i = 0; i < size(); ++i) {
+    auto reference = child(i);
+    // Children are sorted, so every insertion goes at the end
+    branch.emplace_hint(branch.end(), reference.key().to_string(), reference.toNode());
+  }
+  return branch;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
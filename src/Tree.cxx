@@ -4,13 +4,15 @@
 /// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
 
 #include "include/Configuration/Tree.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <map>
+#include <thread>
 #include <boost/throw_exception.hpp>
 #include <boost/variant/get.hpp>
 #include <boost/variant/variant.hpp>
 #include <boost/variant/recursive_variant.hpp>
-#include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
 namespace AliceO2
@@ -20,117 +22,458 @@ namespace Configuration
 namespace Tree
 {
 
-// Split path into segments (either directories or the name of the key)
-// Note: this can be done much more efficiently by just "walking" through the string. But this is easier for now.
-auto splitPath(const std::string& path) -> std::vector<std::string>
+constexpr std::size_t Leaf::INLINE_CAPACITY;
+constexpr std::uint8_t Leaf::SHARED;
+
+static_assert(sizeof(Leaf) == 16, "Leaf should take 16 bytes");
+
+auto Leaf::type() const -> const std::type_info&
+{
+  return Visitor::apply<const std::type_info&>(*this,
+      [](const std::string&) -> const std::type_info& { return typeid(std::string); },
+      [](int) -> const std::type_info& { return typeid(int); },
+      [](bool) -> const std::type_info& { return typeid(bool); },
+      [](double) -> const std::type_info& { return typeid(double); },
+      [](const DoubleArray&) -> const std::type_info& { return typeid(DoubleArray); },
+      [](const IntArray&) -> const std::type_info& { return typeid(IntArray); });
+}
+
+auto Leaf::sharedBytes() const -> std::size_t
+{
+  if (!isShared()) {
+    return 0;
+  }
+  switch (mType) {
+    case Type::String:
+      return sizeof(LeafImplementation::Shared<std::string>);
+    case Type::DoubleArray:
+      return sizeof(LeafImplementation::Shared<DoubleArray>);
+    default:
+      return sizeof(LeafImplementation::Shared<IntArray>);
+  }
+}
+
+void Leaf::destroyShared()
+{
+  switch (mType) {
+    case Type::String:
+      delete static_cast<const LeafImplementation::Shared<std::string>*>(shared());
+      break;
+    case Type::DoubleArray:
+      delete static_cast<const LeafImplementation::Shared<DoubleArray>*>(shared());
+      break;
+    default:
+      delete static_cast<const LeafImplementation::Shared<IntArray>*>(shared());
+      break;
+  }
+}
+
+bool operator==(const Leaf& a, const Leaf& b)
+{
+  if (a.mType != b.mType) {
+    return false;
+  }
+  if (a.isShared() && b.isShared() && a.shared() == b.shared()) {
+    return true;
+  }
+  switch (a.mType) {
+    case Leaf::Type::String:
+      return a.getStringView() == b.getStringView();
+    case Leaf::Type::Int:
+      return *a.getIf<int>() == *b.getIf<int>();
+    case Leaf::Type::Double:
+      return *a.getIf<double>() == *b.getIf<double>();
+    case Leaf::Type::Bool:
+      return *a.getIf<bool>() == *b.getIf<bool>();
+    case Leaf::Type::DoubleArray:
+      return *a.getIf<DoubleArray>() == *b.getIf<DoubleArray>();
+    case Leaf::Type::IntArray:
+      break;
+  }
+  return *a.getIf<IntArray>() == *b.getIf<IntArray>();
+}
+
+bool operator<(const Leaf& a, const Leaf& b)
+{
+  if (a.mType != b.mType) {
+    return a.mType < b.mType;
+  }
+  switch (a.mType) {
+    case Leaf::Type::String:
+      return a.getStringView() < b.getStringView();
+    case Leaf::Type::Int:
+      return *a.getIf<int>() < *b.getIf<int>();
+    case Leaf::Type::Double:
+      return *a.getIf<double>() < *b.getIf<double>();
+    case Leaf::Type::Bool:
+      return *a.getIf<bool>() < *b.getIf<bool>();
+    case Leaf::Type::DoubleArray:
+      return *a.getIf<DoubleArray>() < *b.getIf<DoubleArray>();
+    case Leaf::Type::IntArray:
+      break;
+  }
+  return *a.getIf<IntArray>() < *b.getIf<IntArray>();
+}
+
+std::ostream& operator<<(std::ostream& stream, const Leaf& leaf)
+{
+  if (leaf.getType() == Leaf::Type::String) {
+    auto value = leaf.getStringView();
+    return stream.write(value.data(), std::streamsize(value.size()));
+  }
+  Visitor::apply(leaf, [&](const auto& value) { stream << value; });
+  return stream;
+}
+
+auto splitPath(boost::string_view path) -> std::vector<std::string>
 {
-  // Strip leading and trailing '/', or the first/last segment in path will be an empty string
-  auto trimmedPath = boost::trim_copy_if(path, boost::algorithm::is_any_of("/ "));
   std::vector<std::string> split;
-  if (!trimmedPath.empty()) {
-    boost::split(split, trimmedPath, boost::is_any_of("/"));
+  for (const auto& segment : PathSegments(path)) {
+    split.push_back(segment.to_string());
   }
   return split;
 }
 
-auto getSubtree(const Node& tree, const std::string& path) -> const Node&
+auto getSubtree(const Node& tree, boost::string_view path) -> const Node&
 {
-  auto pathSegments = splitPath(path);
-
   // Traverse branches
   const Node* node = &tree;
-  for (int i = 0; i < pathSegments.size(); ++i) {
-    try {
-      node = &(boost::get<const Branch&>(node)->at(pathSegments[i]));
-    }
-    catch (const std::out_of_range& e) {
-      BOOST_THROW_EXCEPTION(e);
+  for (const auto& segment : PathSegments(path)) {
+    const auto* branch = boost::get<Branch>(node);
+    if (branch == nullptr) {
+      BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + path.to_string() + "' goes through a leaf"));
     }
+    node = &at(*branch, segment);
   }
 
   return *node;
 }
 
-auto keyValuesToTree(const std::vector<std::pair<std::string, Leaf>>& pairs) -> Node
+auto find(const Node& tree, boost::string_view path) -> const Node*
 {
-  Branch treeRoot;
+  const Node* node = &tree;
+  for (const auto& segment : PathSegments(path)) {
+    const auto* branch = boost::get<Branch>(node);
+    if (branch == nullptr) {
+      return nullptr;
+    }
+    node = Tree::find(*branch, segment);
+    if (node == nullptr) {
+      return nullptr;
+    }
+  }
+  return node;
+}
 
-  for (auto& pair : pairs) {
-    auto pathSegments = splitPath(pair.first);
+namespace
+{
+/// Calls function(i) for i in [0, threads), each on its own thread
+template <class Function>
+void runInParallel(std::size_t threads, Function function)
+{
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(function, i);
+  }
+  function(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
 
-    if (pathSegments.empty()) {
-      continue;
+/// Builds a tree from key-value pairs by sorting them by path first, and then building every branch in one pass.
+///
+/// Because the pairs are sorted, all pairs under the same branch are next to each other, so each branch is visited
+/// exactly once, and the children of a branch arrive in key order and can be appended using hinted insertion.
+/// To be identical to inserting the pairs one by one, two rules apply when keys collide:
+///   * a key that is a directory in any path is a branch, even if some pair also assigns a value to it
+///   * when several pairs have the same path, the first one wins. A stable sort keeps them in their original order.
+class BulkBuilder
+{
+  public:
+    using Pairs = std::vector<std::pair<std::string, Leaf>>;
+
+    BulkBuilder(const Pairs& pairs, std::size_t threads) : mPairs(pairs), mThreads(std::max<std::size_t>(threads, 1))
+    {
+      tokenize();
+      sort();
+    }
+
+    auto build() -> Node
+    {
+      Branch root;
+      if (mThreads == 1) {
+        buildBranch(mEntries.begin(), mEntries.end(), 0, root);
+      } else {
+        buildRootInParallel(root);
+      }
+      return root;
     }
 
-    // Gets the last segment. This is not a directory but the "key name" (analogous to a filename)
-    std::string keyName = pathSegments.back();
-    pathSegments.pop_back();
+  private:
+    /// A pair and the range of its segments in mSegments
+    struct Entry
+    {
+        std::size_t pair;
+        std::size_t firstSegment;
+        std::size_t segmentCount;
+    };
 
-    // Traverses or creates directories
-    Branch* node = &treeRoot; // Current node
-    for (int i = 0; i < pathSegments.size(); ++i) {
-      const auto& directory = pathSegments[i]; // The "directory" to add or get
-      if (node->count(directory)) {
-        // Key was already present
-        if (auto* branch = boost::get<Branch>(&node->at(directory))) {
-          // Key was branch, leave alone
+    using Iterator = std::vector<Entry>::const_iterator;
+
+    auto segment(const Entry& entry, std::size_t depth) const -> boost::string_view
+    {
+      return mSegments[entry.firstSegment + depth];
+    }
+
+    /// Splits all paths into one shared segment array, skipping pairs with an empty path
+    void tokenize()
+    {
+      mEntries.reserve(mPairs.size());
+      for (std::size_t i = 0; i < mPairs.size(); ++i) {
+        auto first = mSegments.size();
+        for (const auto& segment : PathSegments(mPairs[i].first)) {
+          mSegments.push_back(segment);
+        }
+        if (mSegments.size() != first) {
+          mEntries.push_back(Entry{i, first, mSegments.size() - first});
+        }
+      }
+    }
+
+    /// Orders entries segment by segment, the same way the Branch maps order their keys
+    bool less(const Entry& a, const Entry& b) const
+    {
+      auto aFirst = mSegments.begin() + a.firstSegment;
+      auto bFirst = mSegments.begin() + b.firstSegment;
+      return std::lexicographical_compare(aFirst, aFirst + a.segmentCount, bFirst, bFirst + b.segmentCount);
+    }
+
+    void sort()
+    {
+      auto compare = [this](const Entry& a, const Entry& b) { return less(a, b); };
+
+      // Pairs from a recursive get usually arrive sorted already
+      if (std::is_sorted(mEntries.begin(), mEntries.end(), compare)) {
+        return;
+      }
+
+      if (mThreads == 1) {
+        std::stable_sort(mEntries.begin(), mEntries.end(), compare);
+        return;
+      }
+
+      // Sort chunks in parallel, then merge neighbouring chunks until one is left. Both steps are stable.
+      std::vector<std::size_t> bounds;
+      for (std::size_t i = 0; i <= mThreads; ++i) {
+        bounds.push_back(mEntries.size() * i / mThreads);
+      }
+      runInParallel(mThreads, [&](std::size_t chunk) {
+        std::stable_sort(mEntries.begin() + bounds[chunk], mEntries.begin() + bounds[chunk + 1], compare);
+      });
+      for (std::size_t width = 1; width < mThreads; width *= 2) {
+        for (std::size_t i = 0; i + width < mThreads; i += 2 * width) {
+          auto last = std::min(i + 2 * width, mThreads);
+          std::inplace_merge(mEntries.begin() + bounds[i], mEntries.begin() + bounds[i + width],
+              mEntries.begin() + bounds[last], compare);
+        }
+      }
+    }
+
+    /// Finds the end of the group of entries that share the segment at the given depth with the first entry
+    auto groupEnd(Iterator first, Iterator last, std::size_t depth) const -> Iterator
+    {
+      auto key = segment(*first, depth);
+      return std::find_if(first, last, [&](const Entry& entry) { return segment(entry, depth) != key; });
+    }
+
+    /// Finds the first entry of a group that goes deeper than the given depth, i.e. that uses the key as a directory.
+    /// Entries ending at this depth are leaves, and sort before the longer ones.
+    /// \return The first directory entry, or the end of the group if the key is a leaf
+    auto firstDirectory(Iterator first, Iterator last, std::size_t depth) const -> Iterator
+    {
+      return std::find_if(first, last, [&](const Entry& entry) { return entry.segmentCount > depth + 1; });
+    }
+
+    void buildBranch(Iterator first, Iterator last, std::size_t depth, Branch& branch) const
+    {
+      while (first != last) {
+        auto end = groupEnd(first, last, depth);
+        auto directories = firstDirectory(first, end, depth);
+        auto key = segment(*first, depth).to_string();
+        if (directories != end) {
+          auto iter = branch.emplace_hint(branch.end(), std::move(key), Branch());
+          buildBranch(directories, end, depth + 1, boost::get<Branch>(iter->second));
         } else {
-          // Key was leaf, replace with branch
-          (*node)[directory] = Branch();
+          branch.emplace_hint(branch.end(), std::move(key), mPairs[first->pair].second);
         }
-        node = &(boost::get<Branch>(node->at(directory))); // Set current node to the new Branch
-      } else {
-        // Key was not yet present
-        auto iter = node->emplace(directory, Branch()).first; // Insert Branch and get an iterator to it
-        node = &(boost::get<Branch>(iter->second)); // Set current node to the new Branch
+        first = end;
       }
     }
 
-    // Finally, we add the value
-    node->insert(std::make_pair(keyName, pair.second));
-  }
+    /// Builds the top-level subtrees on separate threads, then moves them into the root
+    void buildRootInParallel(Branch& root) const
+    {
+      struct Group
+      {
+          Iterator first;
+          Iterator directories;
+          Iterator last;
+          Node node;
+      };
+
+      std::vector<Group> groups;
+      for (auto first = mEntries.begin(); first != mEntries.end(); first = groups.back().last) {
+        auto end = groupEnd(first, mEntries.end(), 0);
+        groups.push_back(Group{first, firstDirectory(first, end, 0), end, Node()});
+      }
+
+      std::atomic<std::size_t> next(0);
+      runInParallel(std::min(mThreads, groups.size()), [&](std::size_t) {
+        for (auto i = next++; i < groups.size(); i = next++) {
+          auto& group = groups[i];
+          if (group.directories != group.last) {
+            Branch branch;
+            buildBranch(group.directories, group.last, 1, branch);
+            group.node = std::move(branch);
+          } else {
+            group.node = mPairs[group.first->pair].second;
+          }
+        }
+      });
+
+      for (auto& group : groups) {
+        root.emplace_hint(root.end(), segment(*group.first, 0).to_string(), std::move(group.node));
+      }
+    }
 
-  return treeRoot;
+    const Pairs& mPairs;
+    const std::size_t mThreads;
+    std::vector<boost::string_view> mSegments; ///< Segments of all paths, views into mPairs
+    std::vector<Entry> mEntries;
+};
+} // Anonymous namespace
+
+auto keyValuesToTree(const std::vector<std::pair<std::string, Leaf>>& pairs, std::size_t threads) -> Node
+{
+  return BulkBuilder(pairs, threads).build();
 }
 
-void treeToKeyValuesHelper(const Node& node, std::vector<std::pair<std::string, Leaf>>& pairs,
-    std::vector<std::string>& pathStack)
+namespace
 {
-  auto makeKey = [&pathStack]{
-      std::ostringstream stream;
-      stream << '/'; // Add leading slash
-      for (int i = 0; i < pathStack.size(); ++i) {
-        stream << pathStack[i];
-        if (i + 1 < pathStack.size()) {
-          // Add slash between paths only if we're not at the end
-          stream << '/';
+auto countLeaves(const Node& node) -> std::size_t
+{
+  return Visitor::apply<std::size_t>(node,
+      [](const Branch& branch) {
+        std::size_t count = 0;
+        for (const auto& keyValuePair : branch) {
+          count += countLeaves(keyValuePair.second);
         }
-      }
-      return stream.str();
-  };
+        return count;
+      },
+      [](const Leaf&) {
+        return std::size_t(1);
+      });
+}
 
+/// Writes the key-value pairs of a subtree into a pre-sized range of the output, starting at index 'next'.
+/// The path is kept in a single buffer that is appended to when going down into a branch and truncated when coming
+/// back up, so every key costs one string copy no matter how deep the tree is.
+void writeKeyValues(const Node& node, std::string& path, std::vector<std::pair<std::string, Leaf>>& pairs,
+    std::size_t& next)
+{
   Visitor::apply(node,
       [&](const Branch& branch) {
+        auto size = path.size();
         for (const auto& keyValuePair : branch) {
-          pathStack.push_back(keyValuePair.first);
-          treeToKeyValuesHelper(keyValuePair.second, pairs, pathStack);
-          pathStack.pop_back();
+          path += '/';
+          path += keyValuePair.first;
+          writeKeyValues(keyValuePair.second, path, pairs, next);
+          path.resize(size);
         }
       },
       [&](const Leaf& leaf) {
-        pairs.emplace_back(makeKey(), leaf);
-      }
-  );
+        auto& pair = pairs[next++];
+        pair.first = path.empty() ? std::string("/") : path;
+        pair.second = leaf;
+      });
 }
+} // Anonymous namespace
 
-auto treeToKeyValues(const Node& node) -> const std::vector<std::pair<std::string, Leaf>>
+auto treeToKeyValues(const Node& node, std::size_t threads) -> std::vector<std::pair<std::string, Leaf>>
 {
   std::vector<std::pair<std::string, Leaf>> pairs;
-  std::vector<std::string> pathStack;
-  treeToKeyValuesHelper(node, pairs, pathStack);
+  const auto* root = boost::get<Branch>(&node);
+
+  if (threads <= 1 || root == nullptr || root->size() < 2) {
+    pairs.resize(countLeaves(node));
+    std::string path;
+    std::size_t next = 0;
+    writeKeyValues(node, path, pairs, next);
+    return pairs;
+  }
+
+  // Every top-level branch gets its own slice of the output, so the threads can fill them independently
+  std::vector<const Branch::value_type*> children;
+  std::vector<std::size_t> offsets;
+  std::size_t total = 0;
+  for (const auto& keyValuePair : *root) {
+    children.push_back(&keyValuePair);
+    offsets.push_back(total);
+    total += countLeaves(keyValuePair.second);
+  }
+  pairs.resize(total);
+
+  std::atomic<std::size_t> nextChild(0);
+  runInParallel(std::min(threads, children.size()), [&](std::size_t) {
+    std::string path;
+    for (auto i = nextChild++; i < children.size(); i = nextChild++) {
+      path = "/" + children[i]->first;
+      std::size_t next = offsets[i];
+      writeKeyValues(children[i]->second, path, pairs, next);
+    }
+  });
   return pairs;
 }
 
+LeafRange::Iterator::Iterator(const Node& node)
+{
+  if (const auto* branch = boost::get<Branch>(&node)) {
+    mStack.reserve(8);
+    mStack.push_back(Frame{branch->begin(), branch->end(), 0});
+    advance();
+  } else {
+    // The root itself is the only leaf, and has the same path treeToKeyValues() gives it
+    mPath = "/";
+    mLeaf = &boost::get<Leaf>(node);
+  }
+}
+
+void LeafRange::Iterator::advance()
+{
+  while (!mStack.empty()) {
+    auto& frame = mStack.back();
+    if (frame.next == frame.end) {
+      mStack.pop_back();
+      continue;
+    }
+
+    const auto& keyValuePair = *frame.next;
+    ++frame.next;
+    mPath.resize(frame.pathSize);
+    mPath += '/';
+    mPath += keyValuePair.first;
+
+    if (const auto* leaf = boost::get<Leaf>(&keyValuePair.second)) {
+      mLeaf = leaf;
+      return;
+    }
+    const auto& branch = boost::get<Branch>(keyValuePair.second);
+    // Note that this may invalidate 'frame'
+    mStack.push_back(Frame{branch.begin(), branch.end(), mPath.size()});
+  }
+  mLeaf = nullptr;
+}
 
 } // namespace Tree
 } // namespace Configuration
@@ -0,0 +1,78 @@
+/// \file TreeBind.cxx
+/// \brief Binding of trees to C++ structs, based on compile-time field descriptors
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeBind.h"
+#include <sstream>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+auto makeMessage(const std::vector<BindFailure>& failures) -> std::string
+{
+  std::ostringstream stream;
+  stream << "Could not bind " << failures.size() << (failures.size() == 1 ? " field:" : " fields:");
+  for (const auto& failure : failures) {
+    stream << "\n  " << failure.path << ": " << failure.reason;
+  }
+  return stream.str();
+}
+
+auto describe(const Leaf& leaf) -> std::string
+{
+  return Visitor::apply<std::string>(leaf,
+      [](const std::string& value) { return "string \"" + value + "\""; },
+      [](int value) { return "int " + std::to_string(value); },
+      [](bool value) { return std::string(value ? "bool true" : "bool false"); },
+      [](double value) { return "double " + boost::lexical_cast<std::string>(value); },
+      [](const DoubleArray& value) { return "double array of " + std::to_string(value.size()) + " elements"; },
+      [](const IntArray& value) { return "int array of " + std::to_string(value.size()) + " elements"; });
+}
+} // Anonymous namespace
+
+BindError::BindError(std::vector<BindFailure> failures)
+    : std::runtime_error(makeMessage(failures)), mFailures(std::move(failures))
+{
+}
+
+namespace BindImplementation
+{
+void Context::fail(std::string reason)
+{
+  std::string path;
+  for (const auto& key : mPath) {
+    path += '/';
+    path.append(key.data(), key.size());
+  }
+  mFailures.push_back(BindFailure {path.empty() ? "/" : path, std::move(reason)});
+}
+
+void Context::failMissing(boost::string_view key)
+{
+  push(key);
+  fail("missing");
+  pop();
+}
+
+void Context::failConversion(const Leaf& leaf)
+{
+  fail("cannot convert " + describe(leaf) + " to the type of the field");
+}
+
+void Context::throwIfFailed()
+{
+  if (!mFailures.empty()) {
+    BOOST_THROW_EXCEPTION(BindError(std::move(mFailures)));
+  }
+}
+} // namespace BindImplementation
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
@@ -0,0 +1,178 @@
+/// \file TreeDiff.cxx
+/// \brief Computing and applying the differences between two trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeDiff.h"
+#include <stdexcept>
+#include <utility>
+#include <boost/throw_exception.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Walks two trees in lockstep, collecting the differences
+/// \tparam IsSame Predicate telling if two subtrees are known to be equal, so they can be skipped
+template <class IsSame>
+class Differ
+{
+  public:
+    Differ(Delta& delta, IsSame isSame) : mDelta(delta), mIsSame(std::move(isSame))
+    {
+    }
+
+    void compare(const Node& a, const Node& b)
+    {
+      if (mIsSame(a, b)) {
+        return;
+      }
+
+      const auto* branchA = boost::get<Branch>(&a);
+      const auto* branchB = boost::get<Branch>(&b);
+      if (branchA != nullptr && branchB != nullptr) {
+        compareBranches(*branchA, *branchB);
+      } else if (branchA == nullptr && branchB == nullptr) {
+        if (!(boost::get<Leaf>(a) == boost::get<Leaf>(b))) {
+          addChange(Change::Operation::Changed, b);
+        }
+      } else {
+        addChange(Change::Operation::TypeChanged, b);
+      }
+    }
+
+  private:
+    void compareBranches(const Branch& a, const Branch& b)
+    {
+      // Both maps are sorted by key, so a single merge-like pass finds all differences
+      auto iterA = a.begin();
+      auto iterB = b.begin();
+      while (iterA != a.end() || iterB != b.end()) {
+        if (iterB == b.end() || (iterA != a.end() && iterA->first < iterB->first)) {
+          enter(iterA->first);
+          addChange(Change::Operation::Removed, iterA->second);
+          leave(iterA->first);
+          ++iterA;
+        } else if (iterA == a.end() || iterB->first < iterA->first) {
+          enter(iterB->first);
+          addChange(Change::Operation::Added, iterB->second);
+          leave(iterB->first);
+          ++iterB;
+        } else {
+          enter(iterA->first);
+          compare(iterA->second, iterB->second);
+          leave(iterA->first);
+          ++iterA;
+          ++iterB;
+        }
+      }
+    }
+
+    void enter(const std::string& key)
+    {
+      mPath.push_back(key);
+    }
+
+    void leave(const std::string&)
+    {
+      mPath.pop_back();
+    }
+
+    void addChange(Change::Operation operation, const Node& value)
+    {
+      mDelta.push_back(Change{operation, mPath, value});
+    }
+
+    Delta& mDelta;
+    IsSame mIsSame;
+
+    /// Keys of the nodes being compared, pushed and popped as the walk goes up and down the trees
+    std::vector<std::string> mPath;
+};
+
+template <class IsSame>
+auto makeDiff(const Node& a, const Node& b, IsSame isSame) -> Delta
+{
+  Delta delta;
+  Differ<IsSame>(delta, std::move(isSame)).compare(a, b);
+  return delta;
+}
+} // Anonymous namespace
+
+auto diff(const Node& a, const Node& b) -> Delta
+{
+  return makeDiff(a, b, [](const Node& a, const Node& b) { return &a == &b; });
+}
+
+auto diff(HashCache& a, HashCache& b) -> Delta
+{
+  return makeDiff(a.root(), b.root(), [&](const Node& nodeA, const Node& nodeB) {
+    return &nodeA == &nodeB || a.hash(nodeA) == b.hash(nodeB);
+  });
+}
+
+auto Change::pathString() const -> std::string
+{
+  if (path.empty()) {
+    return "/";
+  }
+  std::string string;
+  for (const auto& key : path) {
+    string += '/';
+    string += key;
+  }
+  return string;
+}
+
+void applyDelta(Node& node, const Delta& delta)
+{
+  for (const auto& change : delta) {
+    const auto& segments = change.path;
+    if (segments.empty()) {
+      // The change is on the root itself
+      node = (change.operation == Change::Operation::Removed) ? Node(Branch()) : change.value;
+      continue;
+    }
+
+    // Go to the branch containing the changed node
+    Node* parent = &node;
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+      auto* branch = boost::get<Branch>(parent);
+      if (branch == nullptr) {
+        BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + change.pathString() + "' goes through a leaf"));
+      }
+      auto iter = branch->find(segments[i]);
+      if (iter == branch->end()) {
+        if (change.operation == Change::Operation::Removed) {
+          BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + change.pathString() + "' does not exist"));
+        }
+        iter = branch->emplace(segments[i], Branch()).first;
+      }
+      parent = &iter->second;
+    }
+
+    auto* branch = boost::get<Branch>(parent);
+    if (branch == nullptr) {
+      BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + change.pathString() + "' goes through a leaf"));
+    }
+    auto iter = branch->find(segments.back());
+    if (change.operation == Change::Operation::Removed) {
+      if (iter == branch->end()) {
+        BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + change.pathString() + "' does not exist"));
+      }
+      branch->erase(iter);
+    } else if (iter != branch->end()) {
+      iter->second = change.value;
+    } else {
+      branch->emplace(segments.back(), change.value);
+    }
+  }
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
@@ -0,0 +1,164 @@
+/// \file TreeHash.cxx
+/// \brief Content hashing of trees, for cheap equality and change detection
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeHash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace HashImplementation
+{
+auto hashBytes(const void* data, std::size_t size) -> Hash
+{
+  // 64-bit FNV-1a
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  Hash hash = 0xcbf29ce484222325ULL;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+} // namespace HashImplementation
+
+namespace
+{
+using HashImplementation::hashBytes;
+
+/// Tags distinguishing the types, so that e.g. the int 1 and the bool true get different hashes
+enum Tag : Hash
+{
+  STRING_TAG = 1,
+  INT_TAG,
+  DOUBLE_TAG,
+  BOOL_TAG,
+  BRANCH_TAG,
+  DOUBLE_ARRAY_TAG,
+  INT_ARRAY_TAG
+};
+
+/// Mixes two hashes, based on the splitmix64 finalizer
+Hash combine(Hash a, Hash b)
+{
+  Hash hash = a ^ (b + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2));
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+template <class T>
+Hash hashValue(Tag tag, const T& value)
+{
+  return combine(tag, hashBytes(&value, sizeof(value)));
+}
+
+/// Bit pattern of a double, except that 0.0 and -0.0 give the same, since they compare equal
+std::uint64_t doubleBits(double value)
+{
+  std::uint64_t bits = 0;
+  if (value != 0.0) {
+    std::memcpy(&bits, &value, sizeof(bits));
+  }
+  return bits;
+}
+
+Hash hashDoubles(const DoubleArray& array)
+{
+  bool hasNegativeZero = std::any_of(array.begin(), array.end(), [](double value) {
+    return value == 0.0 && std::signbit(value);
+  });
+  if (!hasNegativeZero) {
+    return combine(DOUBLE_ARRAY_TAG, hashBytes(array.data(), array.size() * sizeof(double)));
+  }
+
+  std::vector<std::uint64_t> bits;
+  bits.reserve(array.size());
+  for (double value : array) {
+    bits.push_back(doubleBits(value));
+  }
+  return combine(DOUBLE_ARRAY_TAG, hashBytes(bits.data(), bits.size() * sizeof(std::uint64_t)));
+}
+} // Anonymous namespace
+
+namespace HashImplementation
+{
+auto branchSeed() -> Hash
+{
+  return combine(BRANCH_TAG, 0);
+}
+
+auto addChild(Hash branch, boost::string_view key, Hash child) -> Hash
+{
+  return combine(combine(branch, hashBytes(key.data(), key.size())), child);
+}
+} // namespace HashImplementation
+
+auto hash(const Leaf& leaf) -> Hash
+{
+  return Visitor::apply<Hash>(leaf,
+      [](const std::string& value) { return combine(STRING_TAG, hashBytes(value.data(), value.size())); },
+      [](int value) { return hashValue(INT_TAG, std::int64_t(value)); },
+      [](bool value) { return hashValue(BOOL_TAG, std::uint8_t(value)); },
+      [](double value) { return hashValue(DOUBLE_TAG, doubleBits(value)); },
+      [](const DoubleArray& value) { return hashDoubles(value); },
+      [](const IntArray& value) {
+        return combine(INT_ARRAY_TAG, hashBytes(value.data(), value.size() * sizeof(std::int64_t)));
+      });
+}
+
+auto hash(const Node& node) -> Hash
+{
+  return Visitor::apply<Hash>(node,
+      [](const Branch& branch) {
+        Hash result = HashImplementation::branchSeed();
+        for (const auto& keyValuePair : branch) {
+          result = HashImplementation::addChild(result, keyValuePair.first, hash(keyValuePair.second));
+        }
+        return result;
+      },
+      [](const Leaf& leaf) {
+        return hash(leaf);
+      });
+}
+
+auto getHash(const Node& node, boost::string_view path) -> Hash
+{
+  return hash(getSubtree(node, path));
+}
+
+auto HashCache::hash(const Node& node) -> Hash
+{
+  const auto* branch = boost::get<Branch>(&node);
+  if (branch == nullptr) {
+    // Leaves are cheap enough to hash on the fly
+    return Tree::hash(boost::get<Leaf>(node));
+  }
+
+  auto iter = mHashes.find(&node);
+  if (iter != mHashes.end()) {
+    return iter->second;
+  }
+
+  Hash result = HashImplementation::branchSeed();
+  for (const auto& keyValuePair : *branch) {
+    result = HashImplementation::addChild(result, keyValuePair.first, hash(keyValuePair.second));
+  }
+  mHashes.emplace(&node, result);
+  return result;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
@@ -0,0 +1,150 @@
+/// \file TreeOverlay.cxx
+/// \brief Implementation of the Overlay, a merged view of a stack of trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeOverlay.h"
+#include <algorithm>
+#include <stdexcept>
+#include <boost/throw_exception.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Outcome of following a path in a single layer
+enum class Lookup
+{
+  Found, ///< The path exists in the layer
+  Missing, ///< The path does not exist in the layer, so lower layers may have it
+  ThroughLeaf ///< The path goes through a leaf, which hides the path in all lower layers
+};
+
+auto lookup(const Node& layer, boost::string_view path, const Node*& result) -> Lookup
+{
+  const Node* node = &layer;
+  for (const auto& segment : PathSegments(path)) {
+    const auto* branch = boost::get<Branch>(node);
+    if (branch == nullptr) {
+      return Lookup::ThroughLeaf;
+    }
+    auto iter = branch->find(segment);
+    if (iter == branch->end()) {
+      return Lookup::Missing;
+    }
+    node = &iter->second;
+  }
+  result = node;
+  return Lookup::Found;
+}
+
+/// Merges a layer into a tree, with the layer taking precedence
+void mergeInto(Node& target, const Node& layer)
+{
+  auto* targetBranch = boost::get<Branch>(&target);
+  const auto* layerBranch = boost::get<Branch>(&layer);
+  if (targetBranch == nullptr || layerBranch == nullptr) {
+    target = layer;
+    return;
+  }
+
+  for (const auto& keyValuePair : *layerBranch) {
+    auto iter = targetBranch->lower_bound(keyValuePair.first);
+    if (iter != targetBranch->end() && iter->first == keyValuePair.first) {
+      mergeInto(iter->second, keyValuePair.second);
+    } else {
+      targetBranch->emplace_hint(iter, keyValuePair.first, keyValuePair.second);
+    }
+  }
+}
+} // Anonymous namespace
+
+Overlay::Overlay(std::initializer_list<std::reference_wrapper<const Node>> layers)
+{
+  for (const Node& layer : layers) {
+    push(layer);
+  }
+}
+
+auto Overlay::find(boost::string_view path) const -> const Node*
+{
+  for (auto layer = mLayers.rbegin(); layer != mLayers.rend(); ++layer) {
+    const Node* node = nullptr;
+    switch (lookup(**layer, path, node)) {
+      case Lookup::Found:
+        return node;
+      case Lookup::ThroughLeaf:
+        return nullptr;
+      case Lookup::Missing:
+        break;
+    }
+  }
+  return nullptr;
+}
+
+auto Overlay::getSubtree(boost::string_view path) const -> Overlay
+{
+  Overlay subtree;
+  for (auto layer = mLayers.rbegin(); layer != mLayers.rend(); ++layer) {
+    const Node* node = nullptr;
+    auto result = lookup(**layer, path, node);
+    if (result == Lookup::ThroughLeaf) {
+      break;
+    }
+    if (result == Lookup::Found) {
+      if (boost::get<Leaf>(node) != nullptr) {
+        // A leaf is only visible if no branch above it hides it, and it hides everything below it
+        if (subtree.mLayers.empty()) {
+          subtree.mLayers.push_back(node);
+        }
+        break;
+      }
+      subtree.mLayers.push_back(node);
+    }
+  }
+
+  if (subtree.mLayers.empty()) {
+    BOOST_THROW_EXCEPTION(std::out_of_range("Path '" + path.to_string() + "' does not exist in any layer"));
+  }
+  // Collected top-down, but stored bottom first
+  std::reverse(subtree.mLayers.begin(), subtree.mLayers.end());
+  return subtree;
+}
+
+auto Overlay::keys() const -> std::vector<std::string>
+{
+  std::vector<std::string> keys;
+  for (auto layer = mLayers.rbegin(); layer != mLayers.rend(); ++layer) {
+    const auto* branch = boost::get<Branch>(*layer);
+    if (branch == nullptr) {
+      break;
+    }
+    for (const auto& keyValuePair : *branch) {
+      keys.push_back(keyValuePair.first);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+auto Overlay::flatten() const -> Node
+{
+  if (mLayers.empty()) {
+    return Branch();
+  }
+
+  Node merged = *mLayers.front();
+  for (auto layer = std::next(mLayers.begin()); layer != mLayers.end(); ++layer) {
+    mergeInto(merged, **layer);
+  }
+  return merged;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
@@ -0,0 +1,121 @@
+/// \file TreeQuery.cxx
+/// \brief Wildcard path queries over trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeQuery.h"
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Matches a key against a segment pattern with '*' and '?' wildcards
+bool globMatch(boost::string_view pattern, boost::string_view key)
+{
+  std::size_t p = 0;
+  std::size_t k = 0;
+  // Position of the last '*' seen, and the key position it was tried at, to backtrack to on a mismatch
+  std::size_t star = boost::string_view::npos;
+  std::size_t starKey = 0;
+
+  while (k < key.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == key[k])) {
+      ++p;
+      ++k;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      starKey = k;
+    } else if (star != boost::string_view::npos) {
+      // Let the last '*' swallow one more character
+      p = star + 1;
+      k = ++starKey;
+    } else {
+      return false;
+    }
+  }
+
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+} // Anonymous namespace
+
+Query::Query(boost::string_view pattern)
+{
+  for (const auto& segment : PathSegments(pattern)) {
+    auto wildcard = segment.find_first_of("*?");
+    mSegments.push_back(Segment{segment.to_string(),
+        wildcard == boost::string_view::npos ? segment.size() : wildcard});
+  }
+}
+
+void Query::forEach(const Node& node, const Callback& callback) const
+{
+  std::string path;
+  visit(node, 0, path, callback);
+}
+
+auto Query::match(const Node& node) const -> std::vector<Match>
+{
+  std::vector<Match> matches;
+  forEach(node, [&](boost::string_view path, const Node& match) {
+    matches.push_back(Match{path.to_string(), &match});
+  });
+  return matches;
+}
+
+void Query::visit(const Node& node, std::size_t depth, std::string& path, const Callback& callback) const
+{
+  if (depth == mSegments.size()) {
+    callback(path.empty() ? boost::string_view("/") : boost::string_view(path), node);
+    return;
+  }
+
+  const auto* branch = boost::get<Branch>(&node);
+  if (branch == nullptr) {
+    return;
+  }
+
+  const auto& segment = mSegments[depth];
+  auto size = path.size();
+  auto descend = [&](const Branch::value_type& keyValuePair) {
+    path += '/';
+    path += keyValuePair.first;
+    visit(keyValuePair.second, depth + 1, path, callback);
+    path.resize(size);
+  };
+
+  if (segment.literalPrefix == segment.pattern.size()) {
+    auto iter = branch->find(segment.pattern);
+    if (iter != branch->end()) {
+      descend(*iter);
+    }
+    return;
+  }
+
+  // Keys are sorted, so the ones starting with the literal prefix are all next to each other
+  boost::string_view prefix(segment.pattern.data(), segment.literalPrefix);
+  for (auto iter = branch->lower_bound(prefix); iter != branch->end(); ++iter) {
+    boost::string_view key(iter->first);
+    if (!key.starts_with(prefix)) {
+      break;
+    }
+    if (globMatch(segment.pattern, key)) {
+      descend(*iter);
+    }
+  }
+}
+
+auto query(const Node& node, boost::string_view pattern) -> std::vector<Match>
+{
+  return Query(pattern).match(node);
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
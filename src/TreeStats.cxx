@@ -0,0 +1,120 @@
+/// \file TreeStats.cxx
+/// \brief Shape statistics and memory accounting of trees
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeStats.h"
+#include <algorithm>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Heap bytes of a branch container, not including the keys and children
+auto containerBytes(const Branch& branch) -> std::size_t
+{
+  // The Node variant holds its branch in a heap-allocated wrapper
+  std::size_t bytes = sizeof(Branch);
+#ifdef CONFIGURATION_FLAT_BRANCH
+  bytes += branch.capacity() * sizeof(Branch::value_type);
+#else
+  constexpr std::size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*); // Red-black tree node header: color and 3 links
+  bytes += branch.size() * (MAP_NODE_OVERHEAD + sizeof(Branch::value_type));
+#endif
+  return bytes;
+}
+
+class StatsCollector
+{
+  public:
+    explicit StatsCollector(Stats& stats) : mStats(stats)
+    {
+    }
+
+    /// Collects the statistics of a subtree, and returns its heap bytes
+    auto collect(const Node& node, std::size_t depth) -> std::size_t
+    {
+      mStats.nodes++;
+      mStats.maxDepth = std::max(mStats.maxDepth, depth);
+      return Visitor::apply<std::size_t>(node,
+          [&](const Branch& branch) {
+            mStats.branches++;
+            mStats.fanout[branch.size()]++;
+            std::size_t bytes = containerBytes(branch);
+            for (const auto& keyValuePair : branch) {
+              auto childBytes = heapBytes(keyValuePair.first) + collect(keyValuePair.second, depth + 1);
+              if (depth == 0) {
+                mStats.childHeapBytes.emplace(keyValuePair.first, childBytes);
+              }
+              bytes += childBytes;
+            }
+            return bytes;
+          },
+          [&](const Leaf& leaf) {
+            mStats.leaves++;
+            Visitor::apply(leaf,
+                [&](const std::string&) { mStats.leafTypes.strings++; },
+                [&](int) { mStats.leafTypes.ints++; },
+                [&](bool) { mStats.leafTypes.bools++; },
+                [&](double) { mStats.leafTypes.doubles++; },
+                [&](const DoubleArray&) { mStats.leafTypes.doubleArrays++; },
+                [&](const IntArray&) { mStats.leafTypes.intArrays++; });
+            return heapBytes(leaf);
+          });
+    }
+
+  private:
+    Stats& mStats;
+};
+} // Anonymous namespace
+
+auto heapBytes(const std::string& string) -> std::size_t
+{
+  // With the small string optimization, short strings are stored inside the string object
+  const char* data = string.data();
+  const char* object = reinterpret_cast<const char*>(&string);
+  bool isInline = data >= object && data < object + sizeof(std::string);
+  return isInline ? 0 : string.capacity() + 1;
+}
+
+auto heapBytes(const Leaf& leaf) -> std::size_t
+{
+  // Inline strings are visited as temporaries that fit in the small string buffer, so they count as 0 here too
+  return leaf.sharedBytes() + Visitor::apply<std::size_t>(leaf,
+      [](const std::string& value) { return heapBytes(value); },
+      [](int) { return std::size_t(0); },
+      [](bool) { return std::size_t(0); },
+      [](double) { return std::size_t(0); },
+      [](const DoubleArray& value) { return value.size() * sizeof(double); },
+      [](const IntArray& value) { return value.size() * sizeof(std::int64_t); });
+}
+
+auto heapBytes(const Node& node) -> std::size_t
+{
+  return Visitor::apply<std::size_t>(node,
+      [](const Branch& branch) {
+        std::size_t bytes = containerBytes(branch);
+        for (const auto& keyValuePair : branch) {
+          bytes += heapBytes(keyValuePair.first) + heapBytes(keyValuePair.second);
+        }
+        return bytes;
+      },
+      [](const Leaf& leaf) {
+        return heapBytes(leaf);
+      });
+}
+
+auto stats(const Node& node) -> Stats
+{
+  Stats stats;
+  stats.heapBytes = StatsCollector(stats).collect(node, 0);
+  return stats;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
@@ -0,0 +1,429 @@
+/// \file TreeWriter.cxx
+/// \brief Serialization of trees to JSON and INI
+///
+/// \author Pascal Boeschoten (pascal.boeschoten@cern.ch)
+
+#include "Configuration/TreeWriter.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <boost/throw_exception.hpp>
+
+namespace AliceO2
+{
+namespace Configuration
+{
+namespace Tree
+{
+namespace
+{
+/// Buffer between the writers and their destination. When writing to a stream, the buffer is handed over whenever it
+/// fills up, and the rest by flush() once the document is complete. The rest of a document that failed is dropped.
+/// When writing to a string, the string is the buffer.
+class Output
+{
+  public:
+    /// Writes to the given stream
+    explicit Output(std::ostream& stream) : mBuffer(mOwnBuffer), mStream(&stream)
+    {
+      mBuffer.reserve(FLUSH_SIZE + FLUSH_SIZE / 4);
+    }
+
+    /// Appends to the given string
+    explicit Output(std::string& string) : mBuffer(string), mStream(nullptr)
+    {
+    }
+
+    void put(char character)
+    {
+      mBuffer.push_back(character);
+    }
+
+    void write(boost::string_view string)
+    {
+      mBuffer.append(string.data(), string.size());
+    }
+
+    void write(const char* string, std::size_t size)
+    {
+      mBuffer.append(string, size);
+    }
+
+    void indent(std::size_t spaces)
+    {
+      mBuffer.append(spaces, ' ');
+    }
+
+    void writeInt(std::int64_t value)
+    {
+      char digits[24];
+      char* end = digits + sizeof(digits);
+      char* begin = end;
+      // Work with the magnitude as unsigned, so the minimum value does not overflow
+      std::uint64_t magnitude = value < 0 ? 0u - std::uint64_t(value) : std::uint64_t(value);
+      do {
+        *--begin = char('0' + magnitude % 10);
+        magnitude /= 10;
+      } while (magnitude != 0);
+      if (value < 0) {
+        *--begin = '-';
+      }
+      write(begin, std::size_t(end - begin));
+    }
+
+    /// Writes the shortest of the usual representations that reads back as the same value, with a decimal point or
+    /// an exponent so it is recognizable as a floating point number
+    void writeDouble(double value)
+    {
+      if (writeShortDecimal(value)) {
+        return;
+      }
+
+      char digits[32];
+      int size = std::snprintf(digits, sizeof(digits), "%.15g", value);
+      if (std::strtod(digits, nullptr) != value) {
+        size = std::snprintf(digits, sizeof(digits), "%.17g", value);
+      }
+      write(digits, std::size_t(size));
+      if (boost::string_view(digits, std::size_t(size)).find_first_of(".eEn") == boost::string_view::npos) {
+        write(".0", 2);
+      }
+    }
+
+    /// Fast path for the common case of values with a few decimals, such as 2.0 or 1.25, which avoids the much slower
+    /// printf/strtod round trip.
+    /// If some integer r divided by 10^k gives back the value, the value is the double nearest to the decimal number r
+    /// with k decimals, since both are exactly representable and IEEE division rounds to nearest. That decimal number
+    /// therefore reads back as the same value.
+    /// \return False if no such representation with a few decimals exists, in which case nothing is written
+    bool writeShortDecimal(double value)
+    {
+      constexpr int MAX_DECIMALS = 9;
+      constexpr double MAX_EXACT = 9007199254740992.0; // 2^53, above which not every integer is representable
+      static constexpr double POWERS[MAX_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+      double magnitude = std::fabs(value);
+      if (!(magnitude < MAX_EXACT) || (magnitude == 0.0 && std::signbit(value))) {
+        return false;
+      }
+
+      for (int decimals = 0; decimals <= MAX_DECIMALS; ++decimals) {
+        double scaled = std::round(magnitude * POWERS[decimals]);
+        if (scaled >= MAX_EXACT) {
+          break;
+        }
+        if (scaled / POWERS[decimals] != magnitude) {
+          continue;
+        }
+
+        // Write the digits of the scaled integer from right to left, inserting the decimal point
+        char digits[32];
+        char* end = digits + sizeof(digits) - 2; // Leave room for a ".0" suffix
+        char* begin = end;
+        auto integer = std::uint64_t(scaled);
+        int written = 0;
+        do {
+          *--begin = char('0' + integer % 10);
+          integer /= 10;
+          if (++written == decimals) {
+            *--begin = '.';
+          }
+        } while (integer != 0 || written <= decimals);
+        if (decimals == 0) {
+          *end++ = '.';
+          *end++ = '0';
+        }
+        if (value < 0) {
+          *--begin = '-';
+        }
+        write(begin, std::size_t(end - begin));
+        return true;
+      }
+      return false;
+    }
+
+    /// Hands the buffer to the stream if it is large enough. Called by the writers between values, so the stream gets
+    /// few, large writes.
+    void maybeFlush()
+    {
+      if (mStream != nullptr && mBuffer.size() >= FLUSH_SIZE) {
+        flush();
+      }
+    }
+
+    void flush()
+    {
+      if (mStream != nullptr && !mBuffer.empty()) {
+        mStream->write(mBuffer.data(), std::streamsize(mBuffer.size()));
+        mBuffer.clear();
+      }
+    }
+
+  private:
+    static constexpr std::size_t FLUSH_SIZE = 1 << 16;
+
+    std::string mOwnBuffer;
+    std::string& mBuffer;
+    std::ostream* mStream;
+};
+
+class JsonWriter
+{
+  public:
+    JsonWriter(Output& output, bool pretty) : mOutput(output), mPretty(pretty)
+    {
+    }
+
+    void write(const Node& node, std::size_t depth = 0)
+    {
+      Visitor::apply(node,
+          [&](const Branch& branch) {
+            writeBranch(branch, depth);
+          },
+          [&](const Leaf& leaf) {
+            writeLeaf(leaf);
+          });
+    }
+
+  private:
+    void writeBranch(const Branch& branch, std::size_t depth)
+    {
+      if (branch.empty()) {
+        mOutput.write("{}", 2);
+        return;
+      }
+
+      mOutput.put('{');
+      bool first = true;
+      for (const auto& keyValuePair : branch) {
+        if (!first) {
+          mOutput.put(',');
+        }
+        first = false;
+        if (mPretty) {
+          mOutput.put('\n');
+          mOutput.indent((depth + 1) * 2);
+        }
+        writeString(keyValuePair.first);
+        mPretty ? mOutput.write(": ", 2) : mOutput.put(':');
+        write(keyValuePair.second, depth + 1);
+        mOutput.maybeFlush();
+      }
+      if (mPretty) {
+        mOutput.put('\n');
+        mOutput.indent(depth * 2);
+      }
+      mOutput.put('}');
+    }
+
+    void writeLeaf(const Leaf& leaf)
+    {
+      Visitor::apply(leaf,
+          [&](const std::string& value) { writeString(value); },
+          [&](int value) { mOutput.writeInt(value); },
+          [&](bool value) { value ? mOutput.write("true", 4) : mOutput.write("false", 5); },
+          [&](double value) { writeDouble(value); },
+          [&](const DoubleArray& value) { writeArray(value, [&](double element) { writeDouble(element); }); },
+          [&](const IntArray& value) { writeArray(value, [&](std::int64_t element) { mOutput.writeInt(element); }); });
+    }
+
+    void writeDouble(double value)
+    {
+      if (!std::isfinite(value)) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("JSON cannot represent the value " + std::to_string(value)));
+      }
+      mOutput.writeDouble(value);
+    }
+
+    /// Writes an array on a single line, even when pretty-printing, since arrays tend to be long lists of numbers
+    template <class Array, class WriteElement>
+    void writeArray(const Array& array, WriteElement writeElement)
+    {
+      mOutput.put('[');
+      for (std::size_t i = 0; i < array.size(); ++i) {
+        if (i != 0) {
+          mPretty ? mOutput.write(", ", 2) : mOutput.put(',');
+        }
+        writeElement(array[i]);
+        if (i % 1024 == 1023) {
+          mOutput.maybeFlush();
+        }
+      }
+      mOutput.put(']');
+    }
+
+    /// Writes a quoted string, escaping only what JSON requires. Runs of characters that need no escaping are copied
+    /// in one go.
+    void writeString(boost::string_view string)
+    {
+      mOutput.put('"');
+      std::size_t runStart = 0;
+      for (std::size_t i = 0; i < string.size(); ++i) {
+        auto character = static_cast<unsigned char>(string[i]);
+        if (character >= 0x20 && character != '"' && character != '\\') {
+          continue;
+        }
+        mOutput.write(string.substr(runStart, i - runStart));
+        runStart = i + 1;
+        switch (character) {
+          case '"': mOutput.write("\\\"", 2); break;
+          case '\\': mOutput.write("\\\\", 2); break;
+          case '\n': mOutput.write("\\n", 2); break;
+          case '\r': mOutput.write("\\r", 2); break;
+          case '\t': mOutput.write("\\t", 2); break;
+          case '\b': mOutput.write("\\b", 2); break;
+          case '\f': mOutput.write("\\f", 2); break;
+          default: {
+            char escaped[7];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(character));
+            mOutput.write(escaped, 6);
+          }
+        }
+      }
+      mOutput.write(string.substr(runStart));
+      mOutput.put('"');
+    }
+
+    Output& mOutput;
+    const bool mPretty;
+};
+
+class IniWriter
+{
+  public:
+    IniWriter(Output& output, bool pretty) : mOutput(output), mPretty(pretty)
+    {
+    }
+
+    void write(const Node& node)
+    {
+      const auto* root = boost::get<Branch>(&node);
+      if (root == nullptr) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("INI cannot represent a tree that is a single leaf"));
+      }
+      std::string path;
+      writeBranch(*root, path);
+    }
+
+  private:
+    /// Writes the leaves of a branch in its own section, then its sub-branches
+    void writeBranch(const Branch& branch, std::string& path)
+    {
+      bool hasLeaves = false;
+      for (const auto& keyValuePair : branch) {
+        if (const auto* leaf = boost::get<Leaf>(&keyValuePair.second)) {
+          if (!hasLeaves && !path.empty()) {
+            startSection(path);
+          }
+          hasLeaves = true;
+          writePair(keyValuePair.first, *leaf);
+        }
+      }
+
+      auto size = path.size();
+      for (const auto& keyValuePair : branch) {
+        if (const auto* subBranch = boost::get<Branch>(&keyValuePair.second)) {
+          if (!path.empty()) {
+            path += '/';
+          }
+          path += keyValuePair.first;
+          writeBranch(*subBranch, path);
+          path.resize(size);
+        }
+      }
+    }
+
+    void startSection(boost::string_view path)
+    {
+      check(path, "]");
+      if (mWritten) {
+        mOutput.put('\n');
+      }
+      mOutput.put('[');
+      mOutput.write(path);
+      mOutput.write("]\n", 2);
+    }
+
+    void writePair(boost::string_view key, const Leaf& leaf)
+    {
+      check(key, "=");
+      mOutput.write(key);
+      mPretty ? mOutput.write(" = ", 3) : mOutput.put('=');
+      Visitor::apply(leaf,
+          [&](const std::string& value) {
+            check(value, "");
+            mOutput.write(value);
+          },
+          [&](int value) { mOutput.writeInt(value); },
+          [&](bool value) { mOutput.put(value ? '1' : '0'); },
+          [&](double value) { mOutput.writeDouble(value); },
+          [&](const DoubleArray& value) { writeArray(value, [&](double element) { mOutput.writeDouble(element); }); },
+          [&](const IntArray& value) { writeArray(value, [&](std::int64_t element) { mOutput.writeInt(element); }); });
+      mOutput.put('\n');
+      mOutput.maybeFlush();
+      mWritten = true;
+    }
+
+    /// Writes the elements of an array separated by commas
+    template <class Array, class WriteElement>
+    void writeArray(const Array& array, WriteElement writeElement)
+    {
+      for (std::size_t i = 0; i < array.size(); ++i) {
+        if (i != 0) {
+          mOutput.put(',');
+        }
+        writeElement(array[i]);
+      }
+    }
+
+    /// Throws if the string contains a line break or one of the given characters
+    void check(boost::string_view string, const char* forbidden)
+    {
+      if (string.find_first_of("\r\n") != boost::string_view::npos
+          || string.find_first_of(forbidden) != boost::string_view::npos) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("INI cannot represent '" + string.to_string() + "'"));
+      }
+    }
+
+    Output& mOutput;
+    const bool mPretty;
+    bool mWritten = false;
+};
+} // Anonymous namespace
+
+void writeJson(const Node& node, std::ostream& stream, bool pretty)
+{
+  Output output(stream);
+  JsonWriter(output, pretty).write(node);
+  output.put('\n');
+  output.flush();
+}
+
+auto toJson(const Node& node, bool pretty) -> std::string
+{
+  std::string json;
+  Output output(json);
+  JsonWriter(output, pretty).write(node);
+  return json;
+}
+
+void writeIni(const Node& node, std::ostream& stream, bool pretty)
+{
+  Output output(stream);
+  IniWriter(output, pretty).write(node);
+  output.flush();
+}
+
+auto toIni(const Node& node, bool pretty) -> std::string
+{
+  std::string ini;
+  Output output(ini);
+  IniWriter(output, pretty).write(node);
+  return ini;
+}
+
+} // namespace Tree
+} // namespace Configuration
+} // namespace AliceO2
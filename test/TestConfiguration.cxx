@@ -7,13 +7,23 @@
 /// \todo Clean up
 /// \todo Test all backends in uniform way
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include "Configuration/CachingBackend.h"
 #include "Configuration/ConfigurationFactory.h"
 #include "Configuration/ConfigurationInterface.h"
 #include "Configuration/Visitor.h"
 #include "Configuration/Tree.h"
+#include "Configuration/TreeStats.h"
+#include "Configuration/TreeWriter.h"
 
 #define BOOST_TEST_MODULE hello test
 #define BOOST_TEST_MAIN
@@ -75,6 +85,67 @@ BOOST_AUTO_TEST_CASE(IniFileTest)
   BOOST_CHECK(conf->get<int>("section.key_int").get_value_or(-1) == 123);
   BOOST_CHECK(conf->get<double>("section.key_float").get_value_or(-1.0) == 4.56);
   BOOST_CHECK(conf->get<std::string>("section.key_string").get_value_or("") == "hello");
+
+  // Loading a larger file takes more memory
+  auto memoryUsage = conf->memoryUsage();
+  BOOST_CHECK(memoryUsage > sizeof(ConfigurationInterface));
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream << "[section]\n";
+    for (int i = 0; i < 100; ++i) {
+      stream << "key_" << i << "=value\n";
+    }
+  }
+  conf->setPrefix(TEMP_FILE);
+  BOOST_CHECK(conf->memoryUsage() > memoryUsage + 100 * 8);
+}
+
+BOOST_AUTO_TEST_CASE(PathHandleTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_path.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream <<
+      "key=value\n"
+        "[section]\n"
+        "key_int=123\n"
+        "key_float=4.56\n";
+  }
+
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+
+  //! [Path handle]
+  // Parse the path once, outside of the loop
+  const ConfigurationInterface::Path keyInt("section/key_int");
+  for (int i = 0; i < 3; ++i) {
+    BOOST_CHECK(conf->get<int>(keyInt).get_value_or(-1) == 123);
+  }
+  //! [Path handle]
+
+  BOOST_CHECK(ConfigurationInterface::Path("section/key_int") == keyInt);
+  BOOST_CHECK(ConfigurationInterface::Path("/section/key_int/") != keyInt);
+  BOOST_CHECK(ConfigurationInterface::Path("/section/key_int/").string() == "/section/key_int/");
+  BOOST_CHECK(conf->get<double>(ConfigurationInterface::Path("section/key_float")).get_value_or(-1.0) == 4.56);
+  BOOST_CHECK(conf->get<std::string>(ConfigurationInterface::Path("key")).get_value_or("") == "value");
+  BOOST_CHECK(!conf->get<int>(ConfigurationInterface::Path("section/nope")));
+  BOOST_CHECK(conf->exists(keyInt));
+  BOOST_CHECK(!conf->exists(ConfigurationInterface::Path("section/nope")));
+
+  // A handle resolves exactly like the string it was built from, with any separator
+  auto checkSameAsString = [&](const std::string& path) {
+    BOOST_CHECK_MESSAGE(conf->getString(ConfigurationInterface::Path(path)) == conf->getString(path), path);
+  };
+  for (const auto& path : {"section/key_int", "/section/key_int", "section/key_int/", "/section/key_int/", ""}) {
+    checkSameAsString(path);
+  }
+
+  // Cached lookups follow separator changes
+  conf->setPathSeparator('.');
+  BOOST_CHECK(!conf->exists(keyInt));
+  BOOST_CHECK(conf->get<int>(ConfigurationInterface::Path("section.key_int")).get_value_or(-1) == 123);
+  for (const auto& path : {"section.key_int", ".section.key_int", "section.key_int.", "/section.key_int"}) {
+    checkSameAsString(path);
+  }
 }
 
 inline std::string getReferenceFileName()
@@ -171,6 +242,130 @@ void writeReferenceFile()
   stream << getReferenceJson();
 }
 
+BOOST_AUTO_TEST_CASE(TryGetTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_try_get.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream <<
+      "[section]\n"
+        "key_int=123\n"
+        "key_string=hello\n";
+  }
+
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+
+  //! [Try get]
+  // Neither a missing nor a malformed value throws
+  auto threshold = conf->tryGet<int>("section/threshold");
+  BOOST_CHECK(!threshold);
+  BOOST_CHECK(threshold.error() == LookupError::NotFound);
+  BOOST_CHECK(threshold.valueOr(10) == 10);
+  BOOST_CHECK(conf->tryGet<int>("section/key_string").error() == LookupError::ConversionFailed);
+  BOOST_CHECK(conf->tryGet<int>("section/key_int").valueOr(-1) == 123);
+  //! [Try get]
+
+  BOOST_CHECK(*conf->tryGet<std::string>("section/key_string") == "hello");
+  BOOST_CHECK(conf->tryGet<double>(ConfigurationInterface::Path("section/key_int")).valueOr(-1.0) == 123.0);
+  BOOST_CHECK(!conf->tryGet<std::string>(ConfigurationInterface::Path("section/nope")));
+  BOOST_CHECK_THROW(conf->tryGet<int>("section/nope").value(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GetManyTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_get_many.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream <<
+      "key=value\n"
+        "[section]\n"
+        "key_int=123\n"
+        "key_float=4.56\n"
+        "[other]\n"
+        "key_string=hello\n";
+  }
+
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+
+  // Values come back in the order of the paths, missing ones are empty
+  std::vector<std::string> paths {"section/key_int", "other/key_string", "section/nope", "key", "section/key_float",
+      "nope/key_int", "section/key_int", "/section/key_int", " section/key_int", "section/key_int/", ""};
+  auto values = conf->getMany(paths);
+  BOOST_REQUIRE(values.size() == paths.size());
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    BOOST_CHECK(values[i] == conf->getString(paths[i]));
+  }
+  BOOST_CHECK(values[0].get_value_or("") == "123");
+  BOOST_CHECK(!values[2]);
+  BOOST_CHECK(!values[5]);
+  BOOST_CHECK(conf->getMany({}).empty());
+
+  conf->setPathSeparator('.');
+  values = conf->getMany({"section.key_float", "section/key_float"});
+  BOOST_CHECK(values[0].get_value_or("") == "4.56");
+  BOOST_CHECK(!values[1]);
+}
+
+BOOST_AUTO_TEST_CASE(AsyncTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_async.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream <<
+      "[section]\n"
+        "key_int=123\n";
+  }
+
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+
+  //! [Async]
+  // Start the requests, do other work, then collect the results
+  auto keyInt = conf->getStringAsync("section/key_int");
+  auto missing = conf->getStringAsync("section/nope");
+  BOOST_CHECK(keyInt.get().get_value_or("") == "123");
+  BOOST_CHECK(!missing.get());
+  //! [Async]
+
+  // Backends without I/O complete immediately, and failures are delivered through the future
+  auto put = conf->putStringAsync("section/key_int", "456");
+  BOOST_CHECK(put.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  BOOST_CHECK_THROW(put.get(), std::runtime_error);
+  BOOST_CHECK_THROW(conf->getRecursiveAsync("section").get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulAsyncTest)
+{
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration("consul://localhost:8500?io_threads=4");
+    conf->putString("/test/async/probe", "1");
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  std::vector<std::future<void>> puts;
+  for (int i = 0; i < 100; ++i) {
+    puts.push_back(conf->putStringAsync("/test/async/key_" + std::to_string(i), std::to_string(i)));
+  }
+  for (auto& put : puts) {
+    put.get();
+  }
+
+  std::vector<std::future<ConfigurationInterface::Optional<std::string>>> gets;
+  for (int i = 0; i < 100; ++i) {
+    gets.push_back(conf->getStringAsync("/test/async/key_" + std::to_string(i)));
+  }
+  for (int i = 0; i < 100; ++i) {
+    BOOST_CHECK(gets[i].get().get_value_or("") == std::to_string(i));
+  }
+
+  auto tree = conf->getRecursiveAsync("/test/async/").get();
+  BOOST_CHECK(Tree::getRequired<int>(tree, "key_42") == 42);
+}
+
 BOOST_AUTO_TEST_CASE(RecursiveTest)
 {
   writeReferenceFile();
@@ -220,6 +415,39 @@ BOOST_AUTO_TEST_CASE(RecursiveTest2)
   BOOST_CHECK(getReferenceTree() == conf->getRecursive("/"));
 }
 
+BOOST_AUTO_TEST_CASE(RecursiveSharedTest)
+{
+  writeReferenceFile();
+
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration(getConfigurationUri());
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  BOOST_CHECK(getReferenceTree() == *conf->getRecursiveShared("/"));
+  BOOST_CHECK(getEquipment1() == *conf->getRecursiveShared("/equipment_1"));
+
+  // Handles share the backend's tree instead of copying it
+  BOOST_CHECK(&conf->getRecursiveShared("/equipment_1").get() == &conf->getRecursiveShared("/equipment_1").get());
+
+  // The backend holds the tree once, also when the prefix points into it
+  auto memoryUsage = conf->memoryUsage();
+  BOOST_CHECK(memoryUsage > Tree::heapBytes(getReferenceTree()));
+  conf->setPrefix("/equipment_2");
+  BOOST_CHECK_EQUAL(conf->memoryUsage(), memoryUsage);
+  auto equipment = conf->getRecursiveShared("/");
+  BOOST_CHECK(getEquipment2() == *equipment);
+  Tree::Node modified = Tree::Branch {{"changed", 1}};
+  equipment.mutate() = modified;
+  BOOST_CHECK(getEquipment2() == *conf->getRecursiveShared("/"));
+  BOOST_CHECK(modified == *equipment);
+}
+
 BOOST_AUTO_TEST_CASE(RecursiveTest3)
 {
   writeReferenceFile();
@@ -249,6 +477,108 @@ BOOST_AUTO_TEST_CASE(RecursiveTest3)
   }
 }
 
+BOOST_AUTO_TEST_CASE(WriterRoundTripTest)
+{
+  // A tree written as JSON reads back the same through the JSON backend
+  {
+    std::ofstream stream(getReferenceFileName());
+    Tree::writeJson(getReferenceTree(), stream, true);
+  }
+
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration(getConfigurationUri());
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+  BOOST_CHECK(conf->getRecursive("/") == getReferenceTree());
+}
+
+BOOST_AUTO_TEST_CASE(JsonArrayTest)
+{
+  {
+    std::ofstream stream(getReferenceFileName());
+    stream << R"({"calibration": {"gains": [1.5, 2, -0.5], "pedestals": [1, -2, 3000000000], "empty": []}})";
+  }
+
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration(getConfigurationUri());
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  // Arrays of numbers parse into a single array leaf, integers only if all elements are integers
+  auto tree = conf->getRecursive("/calibration");
+  BOOST_CHECK(Tree::getLeaf(tree, "gains") == Tree::Leaf(Tree::DoubleArray {1.5, 2.0, -0.5}));
+  BOOST_CHECK(Tree::getLeaf(tree, "pedestals") == Tree::Leaf(Tree::IntArray {1, -2, 3000000000}));
+  BOOST_CHECK(Tree::getArray<double>(tree, "empty").empty());
+
+  {
+    std::ofstream stream(getReferenceFileName());
+    stream << R"({"strings": ["a", "b"]})";
+  }
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration(getConfigurationUri()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(IniWriterTest)
+{
+  // A tree written as INI reads back through the file backend, with its values as strings
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_writer.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    Tree::writeIni(getReferenceTree(), stream);
+  }
+
+  // The file backend takes paths without a leading separator
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+  for (const auto& pair : getReferenceMap()) {
+    BOOST_CHECK(conf->getString(ConfigurationInterface::Path(pair.first.substr(1))).get_value_or("") == pair.second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(JsonPathHandleTest)
+{
+  writeReferenceFile();
+
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration(getConfigurationUri());
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  const ConfigurationInterface::Path serial("/equipment_1/serial");
+  BOOST_CHECK(conf->get<int>(serial).get_value_or(-1) == 33333);
+  BOOST_CHECK(conf->get<int>(serial).get_value_or(-1) == 33333);
+  BOOST_CHECK(conf->get<std::string>(ConfigurationInterface::Path("/equipment_2/type")).get_value_or("") == "dummy");
+  BOOST_CHECK(!conf->exists(ConfigurationInterface::Path("/equipment_3/serial")));
+  BOOST_CHECK(!conf->exists(ConfigurationInterface::Path("/equipment_1/serial/too_deep")));
+
+  // Missing paths are not errors
+  BOOST_CHECK_NO_THROW(BOOST_CHECK(!conf->get<int>("/equipment_3/serial")));
+  BOOST_CHECK_NO_THROW(BOOST_CHECK(!conf->get<int>("/equipment_1/serial/too_deep")));
+  BOOST_CHECK(conf->tryGet<int>("/equipment_3/serial").error() == LookupError::NotFound);
+  BOOST_CHECK(conf->tryGet<int>("/equipment_2/type").error() == LookupError::ConversionFailed);
+
+  auto values = conf->getMany({"/equipment_2/type", "/equipment_1/serial", "/equipment_3/serial",
+      "/equipment_1/serial/too_deep"});
+  BOOST_REQUIRE(values.size() == 4);
+  BOOST_CHECK(values[0].get_value_or("") == "dummy");
+  BOOST_CHECK(values[1].get_value_or("") == "33333");
+  BOOST_CHECK(!values[2]);
+  BOOST_CHECK(!values[3]);
+}
+
 BOOST_AUTO_TEST_CASE(RecursiveMapTest)
 {
   writeReferenceFile();
@@ -307,6 +637,449 @@ BOOST_AUTO_TEST_CASE(EtcdTest)
   }
 }
 
+BOOST_AUTO_TEST_CASE(ConsulPutManyTest)
+{
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration("consul://localhost:8500");
+    conf->putString("/test/put_many/probe", "1");
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  //! [Put many]
+  std::vector<std::pair<std::string, Tree::Leaf>> pairs;
+  for (int i = 0; i < 1000; ++i) {
+    pairs.emplace_back("/test/put_many/link_" + std::to_string(i) + "/threshold", i);
+  }
+  pairs.emplace_back("/test/put_many/name", "readout"s);
+  conf->putMany(pairs);
+
+  // A small batch can be put all or nothing
+  conf->putMany({{"/test/put_many/enabled", true}, {"/test/put_many/gain", 1.5}}, true);
+  //! [Put many]
+
+  BOOST_CHECK(conf->get<int>("/test/put_many/link_999/threshold").get_value_or(-1) == 999);
+  BOOST_CHECK(conf->get<std::string>("/test/put_many/name").get_value_or("") == "readout");
+  BOOST_CHECK(conf->get<int>("/test/put_many/enabled").get_value_or(-1) == 1);
+  BOOST_CHECK(conf->get<double>("/test/put_many/gain").get_value_or(-1.0) == 1.5);
+  BOOST_CHECK_THROW(conf->putMany(pairs, true), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ConsulWatchTest)
+{
+  std::unique_ptr<ConfigurationInterface> conf;
+  try {
+    conf = ConfigurationFactory::getConfiguration("consul://localhost:8500");
+    conf->putString("/test/watch/threshold", "1");
+  }
+  catch (const std::exception& e) {
+    BOOST_WARN_MESSAGE(false,
+        std::string("Exception thrown, you may be missing the required infrastructure: ") + e.what());
+    return;
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::map<std::string, boost::optional<std::string>> latest;
+
+  //! [Watch]
+  // The callback runs on the thread of the watch, and only gets the values that changed
+  auto watch = conf->watch("/test/watch", [&](const std::vector<KeyChange>& changes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& change : changes) {
+      latest[change.path] = change.value;
+    }
+    condition.notify_all();
+  });
+  conf->putString("/test/watch/threshold", "2");
+  //! [Watch]
+
+  std::unique_lock<std::mutex> lock(mutex);
+  BOOST_CHECK(condition.wait_for(lock, std::chrono::seconds(5), [&] { return latest.count("/threshold") != 0; }));
+  BOOST_CHECK(latest["/threshold"].get_value_or("") == "2");
+  lock.unlock();
+  BOOST_CHECK(!watch->callbackError());
+
+  // Destroying the handle cancels the watch
+  watch.reset();
+}
+
+BOOST_AUTO_TEST_CASE(WatchUnsupportedTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_watch.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream << "key=value\n";
+  }
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+  BOOST_CHECK_THROW(conf->watch("/", [](const std::vector<KeyChange>&) {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(PutManyUnsupportedTest)
+{
+  // The file backend does not support putting values, so it shows the default implementation
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_put_many.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream << "key=value\n";
+  }
+  auto conf = ConfigurationFactory::getConfiguration("file:/" + TEMP_FILE);
+  BOOST_CHECK_NO_THROW(conf->putMany({}));
+  BOOST_CHECK_THROW(conf->putMany({{"/key", 1}}), std::runtime_error);
+  BOOST_CHECK_THROW(conf->putMany({{"/key", 1}, {"/other_key", 2}}, true), std::runtime_error);
+}
+
+/// Backend keeping its values in memory, counting the gets that reach it
+class CountingBackend : public ConfigurationInterface
+{
+  public:
+    virtual void putString(const std::string& path, const std::string& value) override
+    {
+      values[makeKey(path)] = value;
+    }
+
+    virtual Optional<std::string> getString(const std::string& path) override
+    {
+      gets++;
+      auto iter = values.find(makeKey(path));
+      return iter == values.end() ? Optional<std::string>() : Optional<std::string>(iter->second);
+    }
+
+    virtual void setPrefix(const std::string&) override
+    {
+    }
+
+    virtual void setPathSeparator(char) override
+    {
+    }
+
+    virtual void resetPathSeparator() override
+    {
+    }
+
+    virtual Tree::Node getRecursive(const std::string& path) override
+    {
+      recursiveGets++;
+      auto prefix = makeKey(path);
+      if (prefix.back() != '/') {
+        prefix.push_back('/');
+      }
+      std::vector<std::pair<std::string, Tree::Leaf>> pairs;
+      for (const auto& keyValue : values) {
+        if (keyValue.first.compare(0, prefix.size(), prefix) == 0) {
+          pairs.emplace_back(keyValue.first.substr(prefix.size() - 1), keyValue.second);
+        }
+      }
+      return Tree::keyValuesToTree(pairs);
+    }
+
+    virtual KeyValueMap getRecursiveMap(const std::string&) override
+    {
+      return {};
+    }
+
+    /// Watch that is notified by calling watchCallback directly
+    class CountingWatch : public Watch
+    {
+      public:
+        explicit CountingWatch(WatchCallback& callback) : mCallback(callback)
+        {
+        }
+
+        virtual ~CountingWatch()
+        {
+          cancel();
+        }
+
+        virtual void cancel() override
+        {
+          mCallback = nullptr;
+        }
+
+      private:
+        WatchCallback& mCallback;
+    };
+
+    virtual std::unique_ptr<Watch> watch(const std::string&, WatchCallback callback) override
+    {
+      watchCallback = std::move(callback);
+      return std::make_unique<CountingWatch>(watchCallback);
+    }
+
+    std::map<std::string, std::string> values;
+    int gets = 0;
+    int recursiveGets = 0;
+    WatchCallback watchCallback;
+
+  private:
+    static std::string makeKey(const std::string& path)
+    {
+      return !path.empty() && path.front() == '/' ? path : "/" + path;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(CachingBackendTest)
+{
+  auto backend = std::make_unique<CountingBackend>();
+  auto& inner = *backend;
+  Backends::CachingBackend conf(std::move(backend));
+
+  conf.putString("/section/key", "1");
+  BOOST_CHECK(conf.getString("/section/key").get_value_or("") == "1");
+  BOOST_CHECK(conf.get<int>("/section/key").get_value_or(0) == 1);
+  BOOST_CHECK_EQUAL(inner.gets, 1);
+
+  // Values that do not exist are cached too
+  BOOST_CHECK(!conf.getString("/section/nope"));
+  BOOST_CHECK(!conf.getString("/section/nope"));
+  BOOST_CHECK_EQUAL(inner.gets, 2);
+
+  auto stats = conf.getStats();
+  BOOST_CHECK_EQUAL(stats.hits, 2);
+  BOOST_CHECK_EQUAL(stats.missingHits, 1);
+  BOOST_CHECK_EQUAL(stats.misses, 2);
+  BOOST_CHECK_EQUAL(stats.entries, 2);
+
+  BOOST_CHECK(Tree::getRequired<std::string>(conf.getRecursive("/section"), "key") == "1");
+  BOOST_CHECK(Tree::getRequired<std::string>(conf.getRecursive("/section"), "key") == "1");
+  BOOST_CHECK_EQUAL(inner.recursiveGets, 1);
+
+  // Puts are written through, and invalidate the value and the subtrees containing it
+  conf.putString("/section/key", "2");
+  BOOST_CHECK(inner.values["/section/key"] == "2");
+  BOOST_CHECK(conf.getString("/section/key").get_value_or("") == "2");
+  BOOST_CHECK(Tree::getRequired<std::string>(conf.getRecursive("/section"), "key") == "2");
+  BOOST_CHECK_EQUAL(inner.gets, 3);
+  BOOST_CHECK_EQUAL(inner.recursiveGets, 2);
+  conf.putMany({{"/section/nope", 3}});
+  BOOST_CHECK(conf.getString("/section/nope").get_value_or("") == "3");
+  BOOST_CHECK(conf.getStats().invalidations >= 3);
+
+  // Only the values that are not cached go to the backend
+  inner.values["/other"] = "4";
+  auto values = conf.getMany({"/section/key", "/other", "/section/nope"});
+  BOOST_CHECK(values.at(1).get_value_or("") == "4");
+  BOOST_CHECK_EQUAL(inner.gets, 5);
+
+  BOOST_CHECK(conf.getStringAsync("/other").get().get_value_or("") == "4");
+  BOOST_CHECK_EQUAL(inner.gets, 5);
+
+  conf.clear();
+  BOOST_CHECK_EQUAL(conf.getStats().entries, 0);
+  BOOST_CHECK(conf.getString("/other").get_value_or("") == "4");
+  BOOST_CHECK_EQUAL(inner.gets, 6);
+
+  // Reloading the snapshot does not use the cached tree
+  BOOST_CHECK(conf.snapshot()->get<int>("other").get_value_or(0) == 4);
+  inner.values["/other"] = "5";
+  BOOST_CHECK(conf.reload()->get<int>("other").get_value_or(0) == 5);
+
+  // Paths are cached as given, but a put also invalidates the path with or without a leading slash
+  BOOST_CHECK(conf.getString("section/key").get_value_or("") == "2");
+  BOOST_CHECK(Tree::getRequired<std::string>(conf.getRecursive("section"), "key") == "2");
+  auto gets = inner.gets;
+  auto recursiveGets = inner.recursiveGets;
+  conf.putString("/section/key", "6");
+  BOOST_CHECK(conf.getString("section/key").get_value_or("") == "6");
+  BOOST_CHECK(Tree::getRequired<std::string>(conf.getRecursive("section"), "key") == "6");
+  BOOST_CHECK_EQUAL(inner.gets, gets + 1);
+  BOOST_CHECK_EQUAL(inner.recursiveGets, recursiveGets + 1);
+}
+
+BOOST_AUTO_TEST_CASE(CachingBackendBoundsTest)
+{
+  auto backend = std::make_unique<CountingBackend>();
+  auto& inner = *backend;
+  Backends::CachingBackend::Parameters parameters;
+  parameters.ttl = std::chrono::milliseconds(50);
+  parameters.maxEntries = 2;
+  parameters.shards = 1;
+  parameters.cacheMissing = false;
+  Backends::CachingBackend conf(std::move(backend), parameters);
+  inner.values = {{"/a", "1"}, {"/b", "2"}, {"/c", "3"}};
+
+  // The least recently used value is evicted
+  conf.getString("/a");
+  conf.getString("/b");
+  conf.getString("/a");
+  conf.getString("/c");
+  BOOST_CHECK_EQUAL(conf.getStats().evictions, 1);
+  BOOST_CHECK_EQUAL(conf.getStats().entries, 2);
+  conf.getString("/a");
+  BOOST_CHECK_EQUAL(inner.gets, 3);
+  conf.getString("/b");
+  BOOST_CHECK_EQUAL(inner.gets, 4);
+
+  // Missing values are not cached if disabled
+  conf.getString("/nope");
+  conf.getString("/nope");
+  BOOST_CHECK_EQUAL(inner.gets, 6);
+
+  // Values expire after the TTL
+  inner.values["/a"] = "5";
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(conf.getString("/a").get_value_or("") == "5");
+  BOOST_CHECK_EQUAL(conf.getStats().expirations, 1);
+}
+
+BOOST_AUTO_TEST_CASE(CachingBackendWatchTest)
+{
+  auto backend = std::make_unique<CountingBackend>();
+  auto& inner = *backend;
+  Backends::CachingBackend conf(std::move(backend));
+  inner.values["/section/key"] = "1";
+
+  std::vector<KeyChange> received;
+  {
+    auto watch = conf.watch("/section", [&](const std::vector<KeyChange>& changes) { received = changes; });
+    BOOST_CHECK(conf.getString("/section/key").get_value_or("") == "1");
+    inner.values["/section/key"] = "2";
+    BOOST_CHECK(conf.getString("/section/key").get_value_or("") == "1");
+
+    // The changes a watch reports are removed from the cache
+    inner.watchCallback({{"/key", "2"s}});
+    BOOST_CHECK(conf.getString("/section/key").get_value_or("") == "2");
+    BOOST_REQUIRE_EQUAL(received.size(), 1);
+    BOOST_CHECK(received.front().path == "/key");
+    BOOST_CHECK(received.front().value.get_value_or("") == "2");
+  }
+  BOOST_CHECK(!inner.watchCallback);
+
+  // Destroying the backend cancels its watches, so their handles may outlive it
+  auto caching = std::make_unique<Backends::CachingBackend>(std::make_unique<CountingBackend>());
+  auto watch = caching->watch("/section", [](const std::vector<KeyChange>&) {});
+  caching.reset();
+  BOOST_CHECK_NO_THROW(watch->cancel());
+  watch.reset();
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotTest)
+{
+  CountingBackend conf;
+  conf.putString("/section/key", "1");
+
+  //! [Snapshot]
+  // Readers get the current snapshot and read everything from it, without locks
+  auto snapshot = conf.snapshot();
+  BOOST_CHECK(snapshot->get<int>("section/key").get_value_or(0) == 1);
+
+  // A reload publishes a new snapshot, while readers of the previous one keep seeing it as it was
+  conf.putString("/section/key", "2");
+  auto reloaded = conf.reload();
+  BOOST_CHECK(reloaded->get<int>("section/key").get_value_or(0) == 2);
+  BOOST_CHECK(snapshot->get<int>("section/key").get_value_or(0) == 1);
+  //! [Snapshot]
+
+  BOOST_CHECK_EQUAL(snapshot->version(), 1);
+  BOOST_CHECK_EQUAL(reloaded->version(), 2);
+  BOOST_CHECK(conf.snapshot() == reloaded);
+  BOOST_CHECK(!snapshot->get<int>("section/nope"));
+  BOOST_CHECK(snapshot->getSubtree("section"));
+
+  // The previous snapshot is freed with its last reader
+  std::weak_ptr<const Snapshot> previous = snapshot;
+  snapshot.reset();
+  BOOST_CHECK(previous.expired());
+
+  // Threads getting the first snapshot at the same time share a single load
+  CountingBackend fresh;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&] { fresh.snapshot(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_CHECK_EQUAL(fresh.recursiveGets, 1);
+  BOOST_CHECK_EQUAL(fresh.snapshot()->version(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotConcurrencyTest)
+{
+  CountingBackend conf;
+  conf.putString("/counter", "0");
+  conf.snapshot();
+
+  // Every snapshot has the counter equal to its version minus one, so a reader would notice a torn snapshot
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i) {
+    readers.emplace_back([&] {
+      std::uint64_t lastVersion = 0;
+      while (!done) {
+        auto snapshot = conf.snapshot();
+        if (snapshot->version() < lastVersion
+            || snapshot->get<int>("counter").get_value_or(-1) != int(snapshot->version()) - 1) {
+          failures++;
+        }
+        lastVersion = snapshot->version();
+      }
+    });
+  }
+  for (int i = 1; i <= 200; ++i) {
+    conf.putString("/counter", std::to_string(i));
+    conf.reload();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  BOOST_CHECK_EQUAL(failures, 0);
+  BOOST_CHECK_EQUAL(conf.snapshot()->version(), 201);
+}
+
+BOOST_AUTO_TEST_CASE(CachingBackendFactoryTest)
+{
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_file_caching.ini";
+  {
+    std::ofstream stream(TEMP_FILE);
+    stream <<
+      "[section]\n"
+        "key_int=123\n";
+  }
+
+  //! [Caching backend]
+  auto conf = ConfigurationFactory::getConfiguration("cache+file:/" + TEMP_FILE + "?ttl=10s&max=1000");
+  BOOST_CHECK(conf->get<int>("section/key_int").get_value_or(0) == 123);
+  BOOST_CHECK(conf->get<int>("section/key_int").get_value_or(0) == 123);
+
+  auto stats = dynamic_cast<Backends::CachingBackend&>(*conf).getStats();
+  BOOST_CHECK_EQUAL(stats.hits, 1);
+  BOOST_CHECK_EQUAL(stats.misses, 1);
+  //! [Caching backend]
+
+  BOOST_CHECK_THROW(ConfigurationFactory::getConfiguration("cache+file:/" + TEMP_FILE + "?ttl=5h"),
+      std::runtime_error);
+
+  // Flags take true, false, 1 or 0, and invalid values name the parameter
+  auto getMissingHits = [&](const std::string& options) {
+    auto cached = ConfigurationFactory::getConfiguration("cache+file:/" + TEMP_FILE + "?" + options);
+    cached->getString("section/nope");
+    cached->getString("section/nope");
+    return dynamic_cast<Backends::CachingBackend&>(*cached).getStats().missingHits;
+  };
+  BOOST_CHECK_EQUAL(getMissingHits("cache_missing=true&shards=2&max_bytes=1000000"), 1);
+  BOOST_CHECK_EQUAL(getMissingHits("cache_missing=1"), 1);
+  BOOST_CHECK_EQUAL(getMissingHits("ttl=500ms&cache_missing=false"), 0);
+  BOOST_CHECK_EQUAL(getMissingHits("cache_missing=0"), 0);
+  for (const auto& options : {"cache_missing=yes", "max=-1", "shards=two", "ttl=s"}) {
+    try {
+      ConfigurationFactory::getConfiguration("cache+file:/" + TEMP_FILE + "?" + options);
+      BOOST_ERROR("No exception for " << options);
+    }
+    catch (const std::runtime_error& e) {
+      auto name = std::string(options).substr(0, std::string(options).find('='));
+      BOOST_CHECK_MESSAGE(std::string(e.what()).find(name == "ttl" ? "duration" : name) != std::string::npos,
+          e.what());
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(TreeConversionTest)
 {
   using namespace Tree;
@@ -3,9 +3,25 @@
 ///
 /// \author Pascal Boeschoten, CERN
 
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <random>
 #include "Configuration/Visitor.h"
+#include "Configuration/FlatTree.h"
+#include "Configuration/SharedNode.h"
 #include "Configuration/Tree.h"
+#include "Configuration/TreeBind.h"
+#include "Configuration/TreeDiff.h"
+#include "Configuration/TreeHash.h"
+#include "Configuration/TreeOverlay.h"
+#include "Configuration/TreeQuery.h"
+#include "Configuration/TreeStats.h"
+#include "Configuration/TreeWriter.h"
 
 #define BOOST_TEST_MODULE hello test
 #define BOOST_TEST_MAIN
@@ -88,4 +104,973 @@ BOOST_AUTO_TEST_CASE(KeyValuePairConversionTest)
   BOOST_CHECK(referencePairs == convertedPairs);
 }
 
+/// Builds a tree by inserting the pairs one by one, the way keyValuesToTree() used to
+Tree::Node insertKeyValues(const std::vector<std::pair<std::string, Tree::Leaf>>& pairs)
+{
+  using namespace Tree;
+  Branch root;
+  for (const auto& pair : pairs) {
+    auto segments = splitPath(pair.first);
+    if (segments.empty()) {
+      continue;
+    }
+    Branch* branch = &root;
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+      auto& child = (*branch)[segments[i]];
+      if (boost::get<Branch>(&child) == nullptr) {
+        child = Branch();
+      }
+      branch = &boost::get<Branch>(child);
+    }
+    branch->insert(std::make_pair(segments.back(), Node(pair.second)));
+  }
+  return root;
+}
+
+/// Tests that the bulk builder gives the same result as inserting pairs one by one, including for colliding keys
+BOOST_AUTO_TEST_CASE(BulkKeyValuesToTreeTest)
+{
+  using namespace Tree;
+
+  std::vector<std::pair<std::string, Leaf>> collisions {
+      {"/a", 1},
+      {"/a/b", 2},
+      {"/a", 3},
+      {"/c/d", 4},
+      {"/c/d", 5},
+      {"/c", 6},
+      {"", 7},
+      {"/e//f", 8},
+      {" /g/ ", 9}};
+  BOOST_CHECK(keyValuesToTree(collisions) == insertKeyValues(collisions));
+  BOOST_CHECK(keyValuesToTree(collisions, 4) == insertKeyValues(collisions));
+
+  // Random paths from a small alphabet, so there are plenty of shared prefixes and collisions
+  std::mt19937 generator(1234);
+  std::uniform_int_distribution<int> depth(1, 4);
+  std::uniform_int_distribution<int> segment(0, 3);
+  std::vector<std::pair<std::string, Leaf>> pairs;
+  for (int i = 0; i < 5000; ++i) {
+    std::string path;
+    for (int d = depth(generator); d > 0; --d) {
+      path += "/k" + std::to_string(segment(generator));
+    }
+    pairs.emplace_back(path, i);
+  }
+  auto reference = insertKeyValues(pairs);
+  BOOST_CHECK(keyValuesToTree(pairs) == reference);
+  BOOST_CHECK(keyValuesToTree(pairs, 3) == reference);
+  BOOST_CHECK(keyValuesToTree(pairs, 16) == reference);
+
+  // Converting back gives every leaf once, in the same order with any amount of threads
+  auto keyValues = treeToKeyValues(reference);
+  BOOST_CHECK(keyValuesToTree(keyValues) == reference);
+  BOOST_CHECK(treeToKeyValues(reference, 4) == keyValues);
+  BOOST_CHECK(treeToKeyValues(reference, 64) == keyValues);
+  BOOST_CHECK(treeToKeyValues(Node(1), 4) == (std::vector<std::pair<std::string, Leaf>> {{"/", 1}}));
+  BOOST_CHECK(treeToKeyValues(Node(Branch()), 4).empty());
+}
+
+/// Tests writing a FlatTree to a file and mapping it back
+BOOST_AUTO_TEST_CASE(FlatTreeFileTest)
+{
+  using namespace Tree;
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_tree.bin";
+
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"enabled", true},
+        {"name", "CRU with a name too long for small string optimization"s},
+        {"links", Branch {
+          {"link_0", 12},
+          {"gain", 1.25}}}}},
+      {"empty", Branch {}}};
+
+  //! [FlatTree file]
+  FlatTree(tree).writeFile(TEMP_FILE);
+
+  // Mapping only checks the header and entries, lookups go straight to the mapped pages
+  FlatTree mapped = FlatTree::mapFile(TEMP_FILE);
+  BOOST_CHECK(mapped.get<int>("/equipment_1/links/link_0") == 12);
+  //! [FlatTree file]
+
+  BOOST_CHECK(mapped.toNode() == tree);
+  BOOST_CHECK(mapped.root().hash() == hash(tree));
+  BOOST_CHECK(mapped.get<std::string>("/equipment_1/name") == "CRU with a name too long for small string optimization"s);
+  BOOST_CHECK(FlatTree::mapFile(TEMP_FILE, true).toNode() == tree);
+
+  // Copies share the mapping, which outlives the original
+  FlatTree copy = mapped;
+  mapped = FlatTree();
+  BOOST_CHECK(copy.get<double>("/equipment_1/links/gain") == 1.25);
+
+  // Rewriting the file replaces it, leaving existing mappings intact
+  FlatTree(Node(Branch{{"other", 1}})).writeFile(TEMP_FILE);
+  BOOST_CHECK(copy.toNode() == tree);
+  BOOST_CHECK(FlatTree::mapFile(TEMP_FILE).get<int>("/other") == 1);
+  FlatTree(tree).writeFile(TEMP_FILE);
+  BOOST_CHECK_THROW(FlatTree(tree).writeFile("/tmp/alice_o2_configuration_does_not_exist/tree.bin"),
+      std::runtime_error);
+
+  // Corruption is detected by the header and entry checks, or by the checksum
+  std::string contents;
+  {
+    std::ifstream stream(TEMP_FILE, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+  auto writeCorrupted = [&](std::size_t position) {
+    std::string corrupted = contents;
+    corrupted[position] ^= 0x40;
+    std::ofstream(TEMP_FILE, std::ios::binary | std::ios::trunc) << corrupted;
+  };
+  writeCorrupted(0);
+  BOOST_CHECK_THROW(FlatTree::mapFile(TEMP_FILE), std::runtime_error);
+  // The most significant byte of the value offset of the entry following the root, behind the 64 byte header
+  writeCorrupted(64 + sizeof(FlatTree::Entry) + offsetof(FlatTree::Entry, value) + 7);
+  BOOST_CHECK_THROW(FlatTree::mapFile(TEMP_FILE), std::runtime_error);
+  // A boolean byte other than 0 or 1 reads as true. The entries are in breadth-first order, so "enabled" is the fourth.
+  const std::size_t enabledPosition = 64 + 3 * sizeof(FlatTree::Entry) + offsetof(FlatTree::Entry, value);
+  BOOST_REQUIRE(contents[enabledPosition] == 1);
+  writeCorrupted(enabledPosition);
+  BOOST_CHECK(FlatTree::mapFile(TEMP_FILE).get<bool>("/equipment_1/enabled") == true);
+  BOOST_CHECK(FlatTree::mapFile(TEMP_FILE).root().find("equipment_1").find("enabled").getLeaf() == Leaf(true));
+  writeCorrupted(contents.size() - 1);
+  BOOST_CHECK_NO_THROW(FlatTree::mapFile(TEMP_FILE));
+  BOOST_CHECK_THROW(FlatTree::mapFile(TEMP_FILE, true), std::runtime_error);
+  std::ofstream(TEMP_FILE, std::ios::binary | std::ios::trunc) << contents.substr(0, contents.size() - 1);
+  BOOST_CHECK_THROW(FlatTree::mapFile(TEMP_FILE), std::runtime_error);
+  BOOST_CHECK_THROW(FlatTree::mapFile("/tmp/alice_o2_configuration_does_not_exist.bin"), std::runtime_error);
+  std::remove(TEMP_FILE.c_str());
+}
+
+/// Tests the path tokenizer, which should split paths the same way splitPath() does
+BOOST_AUTO_TEST_CASE(PathSegmentsTest)
+{
+  using namespace Tree;
+
+  //! [Path segments]
+  std::vector<std::string> segments;
+  for (boost::string_view segment : PathSegments("/dir/subdir/key")) {
+    segments.push_back(segment.to_string());
+  }
+  BOOST_CHECK(segments == std::vector<std::string>({"dir", "subdir", "key"}));
+  //! [Path segments]
+
+  for (const std::string path : {"", "/", " / ", "key", "/key/", "/a//b/", " dir/ key ", "a.b"}) {
+    std::vector<std::string> tokenized;
+    for (const auto& segment : PathSegments(path)) {
+      tokenized.push_back(segment.to_string());
+    }
+    BOOST_CHECK(tokenized == splitPath(path));
+  }
+
+  BOOST_CHECK(PathSegments("//").empty());
+  BOOST_CHECK(std::distance(PathSegments("a.b.c", '.').begin(), PathSegments("a.b.c", '.').end()) == 3);
+
+  // Lookups with a boost::string_view key use the transparent comparator of Branch
+  Node tree = Branch {{"dir", Branch {{"key", 1}}}};
+  BOOST_CHECK(getBranch(tree).find(boost::string_view("dir")) != getBranch(tree).end());
+  BOOST_CHECK(getRequired<int>(getSubtree(tree, "dir"), boost::string_view("key")) == 1);
+  BOOST_CHECK_THROW(getSubtree(tree, "/dir/nope"), std::out_of_range);
+  BOOST_CHECK_THROW(getSubtree(tree, "/dir/key/too_deep"), std::out_of_range);
+}
+
+/// Tests iterating lazily over the leaves of a tree
+BOOST_AUTO_TEST_CASE(LeafRangeTest)
+{
+  using namespace Tree;
+
+  //! [Leaf range]
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"enabled", true},
+        {"empty", Branch {}},
+        {"links", Branch {
+          {"link_0", 1},
+          {"link_1", 2}}}}},
+      {"rate", 1.5}};
+
+  std::vector<std::string> paths;
+  for (const auto& leaf : LeafRange(tree)) {
+    paths.push_back(leaf.first.to_string());
+    if (leaf.second == Leaf(1)) {
+      break; // Stop early, without having visited the rest of the tree
+    }
+  }
+  BOOST_CHECK(paths == std::vector<std::string>({"/equipment_1/enabled", "/equipment_1/links/link_0"}));
+  //! [Leaf range]
+
+  // Same leaves in the same order as treeToKeyValues()
+  auto compare = [](const Node& node) {
+    std::vector<std::pair<std::string, Leaf>> pairs;
+    for (const auto& leaf : LeafRange(node)) {
+      pairs.emplace_back(leaf.first.to_string(), leaf.second);
+    }
+    return pairs == treeToKeyValues(node);
+  };
+  BOOST_CHECK(compare(tree));
+  BOOST_CHECK(compare(Node(Branch())));
+  BOOST_CHECK(compare(Node(Branch {{"a", Branch {{"b", Branch {}}}}})));
+  BOOST_CHECK(compare(Node(42)));
+  BOOST_CHECK(std::distance(LeafRange(tree).begin(), LeafRange(tree).end()) == 4);
+
+  // Iterators are independent copies
+  auto first = LeafRange(tree).begin();
+  auto second = first;
+  ++second;
+  BOOST_CHECK((*first).first == "/equipment_1/enabled");
+  BOOST_CHECK((*second).first == "/equipment_1/links/link_0");
+}
+
+/// Tests the flattened tree representation
+BOOST_AUTO_TEST_CASE(FlatTreeTest)
+{
+  using namespace Tree;
+
+  //! [FlatTree]
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"enabled", true},
+        {"type", "rorc"s},
+        {"gain", 1.5},
+        {"serial", 33333}}},
+      {"equipment_2", Branch {
+        {"serial", "-1"s}}}};
+
+  FlatTree flatTree(tree);
+  BOOST_CHECK(flatTree.get<int>("/equipment_1/serial") == 33333);
+  BOOST_CHECK(flatTree.get<int>("equipment_2/serial/") == -1);
+  BOOST_CHECK(flatTree.get<std::string>("/equipment_1/type") == "rorc"s);
+  BOOST_CHECK(flatTree.getSubtree("/equipment_1/type").getStringView() == "rorc");
+  //! [FlatTree]
+
+  BOOST_CHECK(flatTree.get<double>("/equipment_1/gain") == 1.5);
+  BOOST_CHECK(flatTree.get<bool>("/equipment_1/enabled") == true);
+  BOOST_CHECK(!flatTree.get<int>("/equipment_1/nothing_here"));
+  BOOST_CHECK(!flatTree.get<int>("/equipment_1"));
+  BOOST_CHECK(!flatTree.getSubtree("/equipment_1/serial/too_deep"));
+  BOOST_CHECK(flatTree.getSubtree("/").size() == 2);
+  BOOST_CHECK(flatTree.getSubtree("/equipment_1").child(1).key() == "gain");
+  BOOST_CHECK(flatTree.size() == 8);
+
+  // Round trip, also for subtrees and leaves
+  BOOST_CHECK(flatTree.toNode() == tree);
+  BOOST_CHECK(flatTree.getSubtree("/equipment_1").toNode() == getSubtree(tree, "/equipment_1"));
+  BOOST_CHECK(FlatTree(Leaf(123)).toNode() == Node(123));
+  BOOST_CHECK(FlatTree().toNode() == Node(Branch()));
+}
+
+/// Tests sharing of subtrees and copy-on-write
+BOOST_AUTO_TEST_CASE(SharedNodeTest)
+{
+  using namespace Tree;
+
+  //! [SharedNode]
+  SharedNode tree(Branch {
+      {"equipment_1", Branch {
+        {"serial", 33333}}},
+      {"equipment_2", Branch {
+        {"serial", -1}}}});
+
+  // Taking a subtree does not copy it, it refers into the same tree
+  SharedNode equipment = tree.getSubtree("/equipment_1");
+  BOOST_CHECK(&equipment.get() == &getSubtree(*tree, "/equipment_1"));
+  BOOST_CHECK(getRequired<int>(equipment, "serial") == 33333);
+
+  // Modifying a shared subtree copies it first, so the original tree is not affected
+  boost::get<Branch>(equipment.mutate())["serial"] = 44444;
+  BOOST_CHECK(getRequired<int>(equipment, "serial") == 44444);
+  BOOST_CHECK(getRequired<int>(getSubtree(*tree, "/equipment_1/serial")) == 33333);
+  //! [SharedNode]
+
+  BOOST_CHECK(equipment.unique());
+  BOOST_CHECK(tree.unique());
+
+  // The subtree keeps the tree alive after the original handle is gone
+  SharedNode serial = tree.getSubtree("/equipment_2/serial");
+  tree = SharedNode();
+  BOOST_CHECK(getRequired<int>(serial) == -1);
+
+  // A unique handle is modified in place
+  const Node* address = &serial.get();
+  serial.mutate() = 123;
+  BOOST_CHECK(&serial.get() == address);
+  BOOST_CHECK(serial.materialise() == Node(123));
+}
+
+/// Tests content hashing of trees
+BOOST_AUTO_TEST_CASE(TreeHashTest)
+{
+  using namespace Tree;
+
+  Node live = Branch {
+      {"readout", Branch {
+        {"rate", 1.5},
+        {"equipment", Branch {
+          {"serial", 33333},
+          {"enabled", true}}}}},
+      {"qc", Branch {
+        {"task", "digits"s}}}};
+
+  Node reloaded = live;
+  boost::get<Branch>(boost::get<Branch>(reloaded)["qc"])["task"] = "clusters"s;
+
+  //! [HashCache]
+  HashCache liveHashes(live);
+  HashCache reloadedHashes(reloaded);
+  // Nothing changed under /readout, but something did under /qc
+  BOOST_CHECK(liveHashes.getHash("/readout") == reloadedHashes.getHash("/readout"));
+  BOOST_CHECK(liveHashes.getHash("/qc") != reloadedHashes.getHash("/qc"));
+  BOOST_CHECK(liveHashes.hash() != reloadedHashes.hash());
+  //! [HashCache]
+
+  BOOST_CHECK(hash(live) == liveHashes.hash());
+  BOOST_CHECK(getHash(live, "/readout/equipment") == liveHashes.getHash("/readout/equipment"));
+  BOOST_CHECK(hash(live) == hash(Node(live)));
+
+  // Same value in different types, keys or positions must give different hashes
+  BOOST_CHECK(hash(Leaf(1)) != hash(Leaf(true)));
+  BOOST_CHECK(hash(Leaf(1)) != hash(Leaf(1.0)));
+  BOOST_CHECK(hash(Leaf("1"s)) != hash(Leaf(1)));
+  BOOST_CHECK(hash(Leaf(0.0)) == hash(Leaf(-0.0)));
+  BOOST_CHECK(hash(Node(Branch {{"a", 1}})) != hash(Node(Branch {{"b", 1}})));
+  BOOST_CHECK(hash(Node(Branch {{"a", Branch {{"b", 1}}}})) != hash(Node(Branch {{"a", 1}, {"b", 1}})));
+  BOOST_CHECK(hash(Node(Branch())) != hash(Node(Leaf(""s))));
+
+  // FlatTree computes the same hashes when it is built
+  FlatTree flatTree(reloaded);
+  BOOST_CHECK(flatTree.root().hash() == reloadedHashes.hash());
+  BOOST_CHECK(flatTree.getSubtree("/readout/equipment").hash() == liveHashes.getHash("/readout/equipment"));
+  BOOST_CHECK(flatTree.getSubtree("/readout/rate").hash() == hash(Leaf(1.5)));
+}
+
+/// Tests diffing trees and applying the resulting deltas
+BOOST_AUTO_TEST_CASE(TreeDiffTest)
+{
+  using namespace Tree;
+
+  //! [Diff]
+  Node desired = Branch {
+      {"readout", Branch {
+        {"rate", 2.0},
+        {"equipment", Branch {
+          {"serial", 33333},
+          {"enabled", true}}}}},
+      {"qc", Branch {
+        {"tasks", Branch {
+          {"digits", true}}}}}};
+
+  Node live = Branch {
+      {"readout", Branch {
+        {"rate", 1.5},
+        {"equipment", Branch {
+          {"serial", 33333},
+          {"enabled", true}}}}},
+      {"qc", Branch {
+        {"tasks", "digits"s}}},
+      {"obsolete", Branch {
+        {"a", 1},
+        {"b", 2}}}};
+
+  Delta delta = diff(live, desired);
+  BOOST_REQUIRE_EQUAL(delta.size(), 3);
+  BOOST_CHECK(delta[0].operation == Change::Operation::Removed);
+  BOOST_CHECK_EQUAL(delta[0].pathString(), "/obsolete");
+  BOOST_CHECK(delta[1].operation == Change::Operation::TypeChanged);
+  BOOST_CHECK_EQUAL(delta[1].pathString(), "/qc/tasks");
+  BOOST_CHECK(delta[2].operation == Change::Operation::Changed);
+  BOOST_CHECK_EQUAL(delta[2].pathString(), "/readout/rate");
+  BOOST_CHECK(delta[2].value == Node(2.0));
+
+  applyDelta(live, delta);
+  BOOST_CHECK(live == desired);
+  //! [Diff]
+
+  BOOST_CHECK(diff(desired, desired).empty());
+  BOOST_CHECK(diff(desired, live).empty());
+
+  // Root changes
+  Delta rootDelta = diff(Node(1), Node(2));
+  BOOST_REQUIRE_EQUAL(rootDelta.size(), 1);
+  BOOST_CHECK_EQUAL(rootDelta[0].pathString(), "/");
+  Node root = 1;
+  applyDelta(root, rootDelta);
+  BOOST_CHECK(root == Node(2));
+
+  // Adding below a missing branch creates it, removing a missing path does not work
+  Node empty = Branch();
+  applyDelta(empty, {{Change::Operation::Added, {"x", "y", "z"}, 1}});
+  BOOST_CHECK(empty == Node(Branch {{"x", Branch {{"y", Branch {{"z", 1}}}}}}));
+  BOOST_CHECK_THROW(applyDelta(empty, {{Change::Operation::Removed, {"x", "q"}, Node()}}), std::out_of_range);
+  BOOST_CHECK_THROW(applyDelta(empty, {{Change::Operation::Added, {"x", "y", "z", "w"}, 1}}), std::out_of_range);
+
+  // Keys that a joined path could not represent survive a round trip
+  Node unusual = Branch {{"a/b", 1}, {"", Branch {{" c ", 2}}}};
+  Node plain = Branch();
+  applyDelta(plain, diff(plain, unusual));
+  BOOST_CHECK(plain == unusual);
+
+  // Random trees sharing most of their keys, diffed both directly and through hashes
+  std::mt19937 generator(4321);
+  std::uniform_int_distribution<int> depth(1, 4);
+  std::uniform_int_distribution<int> segment(0, 3);
+  std::uniform_int_distribution<int> value(0, 20);
+  auto randomTree = [&] {
+    std::vector<std::pair<std::string, Leaf>> pairs;
+    for (int i = 0; i < 300; ++i) {
+      std::string path;
+      for (int d = depth(generator); d > 0; --d) {
+        path += "/k" + std::to_string(segment(generator));
+      }
+      pairs.emplace_back(path, value(generator));
+    }
+    return keyValuesToTree(pairs);
+  };
+  for (int i = 0; i < 20; ++i) {
+    Node a = randomTree();
+    Node b = randomTree();
+    Delta direct = diff(a, b);
+    HashCache hashesA(a);
+    HashCache hashesB(b);
+    Delta hashed = diff(hashesA, hashesB);
+    BOOST_REQUIRE_EQUAL(direct.size(), hashed.size());
+    for (std::size_t c = 0; c < direct.size(); ++c) {
+      BOOST_CHECK(direct[c].path == hashed[c].path);
+    }
+    applyDelta(a, direct);
+    BOOST_CHECK(a == b);
+  }
+
+  // Subtrees with equal hashes are not walked, which shows when a memoized hash is made stale on purpose
+  Node a = Branch {{"x", Branch {{"k", 1}}}, {"other", 1}};
+  Node b = Branch {{"x", Branch {{"k", 1}}}, {"other", 2}};
+  HashCache hashesA(a);
+  HashCache hashesB(b);
+  BOOST_CHECK(hashesA.getHash("/x") == hashesB.getHash("/x"));
+  boost::get<Branch>(boost::get<Branch>(b)["x"])["k"] = 99;
+  Delta hashedDelta = diff(hashesA, hashesB);
+  BOOST_REQUIRE_EQUAL(hashedDelta.size(), 1);
+  BOOST_CHECK(hashedDelta.front().pathString() == "/other");
+}
+
+/// Tests wildcard queries
+BOOST_AUTO_TEST_CASE(TreeQueryTest)
+{
+  using namespace Tree;
+
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"enabled", true},
+        {"links", Branch {
+          {"link_0", Branch {{"threshold", 10}}},
+          {"link_1", Branch {{"threshold", 11}}},
+          {"spare", Branch {{"threshold", 12}}}}}}},
+      {"equipment_2", Branch {
+        {"enabled", false}}},
+      {"equipment", Branch {
+        {"enabled", false}}},
+      {"detector", "TPC"s}};
+
+  //! [Query]
+  // Compile once, evaluate as often as needed
+  Query enabledQuery("/equipment_*/enabled");
+  std::vector<std::string> enabled;
+  enabledQuery.forEach(tree, [&](boost::string_view path, const Node&) {
+    enabled.push_back(path.to_string());
+  });
+  BOOST_CHECK(enabled == std::vector<std::string>({"/equipment_1/enabled", "/equipment_2/enabled"}));
+
+  auto thresholds = query(tree, "/*/links/link_?/threshold");
+  BOOST_REQUIRE_EQUAL(thresholds.size(), 2);
+  BOOST_CHECK_EQUAL(thresholds[0].path, "/equipment_1/links/link_0/threshold");
+  BOOST_CHECK(*thresholds[1].node == Node(11));
+  //! [Query]
+
+  auto paths = [&](boost::string_view pattern) {
+    std::vector<std::string> result;
+    for (const auto& match : query(tree, pattern)) {
+      result.push_back(match.path);
+    }
+    return result;
+  };
+  using Paths = std::vector<std::string>;
+  BOOST_CHECK(paths("/detector") == Paths({"/detector"}));
+  BOOST_CHECK(paths("/nope") == Paths());
+  BOOST_CHECK(paths("/detector/*") == Paths());
+  BOOST_CHECK(paths("") == Paths({"/"}));
+  BOOST_CHECK(paths("/*") == Paths({"/detector", "/equipment", "/equipment_1", "/equipment_2"}));
+  BOOST_CHECK(paths("/equipment*/enabled").size() == 3);
+  BOOST_CHECK(paths("/*/links/*/threshold").size() == 3);
+  BOOST_CHECK(paths("/*1/*/*_*/*") == Paths({"/equipment_1/links/link_0/threshold",
+      "/equipment_1/links/link_1/threshold"}));
+  BOOST_CHECK(paths("/e*t_?") == Paths({"/equipment_1", "/equipment_2"}));
+  BOOST_CHECK(paths("/*e*e*") == Paths({"/detector", "/equipment", "/equipment_1", "/equipment_2"}));
+  BOOST_CHECK(paths("/?") == Paths());
+}
+
+/// Tests the layered view of several trees
+BOOST_AUTO_TEST_CASE(TreeOverlayTest)
+{
+  using namespace Tree;
+
+  //! [Overlay]
+  Node defaults = Branch {
+      {"readout", Branch {
+        {"rate", 1.0},
+        {"buffer", Branch {
+          {"size", 1024},
+          {"pages", 16}}}}},
+      {"qc", Branch {
+        {"enabled", false}}}};
+  Node site = Branch {
+      {"readout", Branch {
+        {"buffer", Branch {
+          {"size", 4096}}}}}};
+  Node run = Branch {
+      {"qc", Branch {
+        {"enabled", true}}}};
+
+  Overlay overlay {defaults, site};
+  overlay.push(run); // Free, nothing is merged until flatten() is called
+
+  BOOST_CHECK(overlay.get<int>("/readout/buffer/size") == 4096); // From the site layer
+  BOOST_CHECK(overlay.get<int>("/readout/buffer/pages") == 16); // From the defaults
+  BOOST_CHECK(overlay.get<bool>("/qc/enabled") == true); // From the run layer
+
+  Overlay buffer = overlay.getSubtree("/readout/buffer");
+  BOOST_CHECK(buffer.keys() == std::vector<std::string>({"pages", "size"}));
+  //! [Overlay]
+
+  BOOST_CHECK(overlay.flatten() == keyValuesToTree({
+      {"/readout/rate", 1.0},
+      {"/readout/buffer/size", 4096},
+      {"/readout/buffer/pages", 16},
+      {"/qc/enabled", true}}));
+  BOOST_CHECK(buffer.size() == 2);
+  BOOST_CHECK(!overlay.get<int>("/readout/buffer"));
+  BOOST_CHECK(!overlay.exists("/readout/nope"));
+  BOOST_CHECK_THROW(overlay.getSubtree("/readout/nope"), std::out_of_range);
+
+  // Leaves hide whole subtrees below them, and branches hide leaves
+  Node bottom = Branch {{"a", Branch {{"x", 1}}}, {"b", 2}};
+  Node middle = Branch {{"a", 5}, {"b", Branch {{"y", 3}}}};
+  Node top = Branch {{"a", Branch {{"z", 4}}}};
+  Overlay layers {bottom, middle, top};
+  BOOST_CHECK(!layers.exists("/a/x"));
+  BOOST_CHECK(layers.get<int>("/a/z") == 4);
+  BOOST_CHECK(layers.getSubtree("/a").keys() == std::vector<std::string>({"z"}));
+  BOOST_CHECK(layers.getSubtree("/b").keys() == std::vector<std::string>({"y"}));
+  BOOST_CHECK(!layers.get<int>("/b"));
+  BOOST_CHECK(layers.getSubtree("/b/y").isLeaf());
+  BOOST_CHECK(layers.flatten() == Node(Branch {{"a", Branch {{"z", 4}}}, {"b", Branch {{"y", 3}}}}));
+
+  // Removing the top layer uncovers what it was hiding
+  layers.pop();
+  BOOST_CHECK(layers.flatten() == Node(Branch {{"a", 5}, {"b", Branch {{"y", 3}}}}));
+  BOOST_CHECK(Overlay().flatten() == Node(Branch()));
+}
+
+/// Tests the JSON and INI writers
+BOOST_AUTO_TEST_CASE(TreeWriterTest)
+{
+  using namespace Tree;
+
+  //! [Writers]
+  Node tree = Branch {
+      {"readout", Branch {
+        {"rate", 2.0},
+        {"name", "say \"hi\"\n"s},
+        {"equipment", Branch {
+          {"serial", -33333},
+          {"enabled", true}}}}},
+      {"version", 3}};
+
+  BOOST_CHECK_EQUAL(toJson(tree),
+      R"({"readout":{"equipment":{"enabled":true,"serial":-33333},"name":"say \"hi\"\n","rate":2.0},"version":3})");
+
+  std::ostringstream stream;
+  writeJson(tree, stream, true);
+  BOOST_CHECK_EQUAL(stream.str(),
+      "{\n"
+      "  \"readout\": {\n"
+      "    \"equipment\": {\n"
+      "      \"enabled\": true,\n"
+      "      \"serial\": -33333\n"
+      "    },\n"
+      "    \"name\": \"say \\\"hi\\\"\\n\",\n"
+      "    \"rate\": 2.0\n"
+      "  },\n"
+      "  \"version\": 3\n"
+      "}\n");
+  //! [Writers]
+
+  BOOST_CHECK_EQUAL(toJson(Node(Branch())), "{}");
+  BOOST_CHECK_EQUAL(toJson(Node(Branch {{"a", Branch()}}), true), "{\n  \"a\": {}\n}");
+  BOOST_CHECK_EQUAL(toJson(Node(0.1)), "0.1");
+  BOOST_CHECK_EQUAL(toJson(Node(1e300)), "1e+300");
+  BOOST_CHECK_EQUAL(toJson(Node(std::numeric_limits<int>::min())), "-2147483648");
+  BOOST_CHECK_EQUAL(toJson(Node(std::string("\x01\t", 2))), "\"\\u0001\\t\"");
+  BOOST_CHECK_THROW(toJson(Node(std::numeric_limits<double>::infinity())), std::runtime_error);
+  BOOST_CHECK(std::stod(toJson(Node(0.1 + 0.2))) == 0.1 + 0.2);
+
+  Node ini = Branch {
+      {"version", 3},
+      {"readout", Branch {
+        {"rate", 2.5},
+        {"enabled", false},
+        {"equipment", Branch {
+          {"serial", 1}}}}},
+      {"empty", Branch {}}};
+  BOOST_CHECK_EQUAL(toIni(ini),
+      "version=3\n"
+      "\n"
+      "[readout]\n"
+      "enabled=0\n"
+      "rate=2.5\n"
+      "\n"
+      "[readout/equipment]\n"
+      "serial=1\n");
+  BOOST_CHECK_EQUAL(toIni(Node(Branch {{"a", Branch {{"b", 1}}}}), true), "[a]\nb = 1\n");
+  BOOST_CHECK_THROW(toIni(Node(Branch {{"a", "two\nlines"s}})), std::runtime_error);
+  BOOST_CHECK_THROW(toIni(Node(1)), std::runtime_error);
+
+  // A document that fails is not written partially, when it is smaller than a chunk
+  std::ostringstream failedStream;
+  BOOST_CHECK_THROW(writeJson(Node(Branch {{"a", 1}, {"b", std::nan("")}}), failedStream), std::runtime_error);
+  BOOST_CHECK_THROW(writeIni(Node(Branch {{"a", 1}, {"b", "two\nlines"s}}), failedStream), std::runtime_error);
+  BOOST_CHECK(failedStream.str().empty());
+
+  // Large trees are written in chunks, with the same result
+  std::vector<std::pair<std::string, Leaf>> pairs;
+  for (int i = 0; i < 20000; ++i) {
+    pairs.emplace_back("/branch_" + std::to_string(i / 100) + "/leaf_" + std::to_string(i), i);
+  }
+  Node large = keyValuesToTree(pairs);
+  std::ostringstream largeStream;
+  writeJson(large, largeStream);
+  BOOST_CHECK_EQUAL(largeStream.str(), toJson(large) + "\n");
+}
+
+/// Tests leaves holding arrays of numbers
+BOOST_AUTO_TEST_CASE(ArrayLeafTest)
+{
+  using namespace Tree;
+
+  //! [Array leaves]
+  Node tree = Branch {
+      {"calibration", Branch {
+        {"gains", DoubleArray {1.0, 1.5, 0.75, 2.0}},
+        {"pedestals", IntArray {100, -3, 7}}}}};
+
+  auto gains = getArray<double>(getSubtree(tree, "/calibration/gains"));
+  double sum = 0;
+  for (double gain : gains) {
+    sum += gain;
+  }
+  BOOST_CHECK(sum == 5.25);
+  BOOST_CHECK(reinterpret_cast<std::uintptr_t>(gains.data()) % ARRAY_ALIGNMENT == 0);
+  //! [Array leaves]
+
+  auto pedestals = getArray<std::int64_t>(getSubtree(tree, "calibration"), "pedestals");
+  BOOST_REQUIRE_EQUAL(pedestals.size(), 3);
+  BOOST_CHECK(pedestals[1] == -3);
+  BOOST_CHECK_THROW(getArray<std::int64_t>(getSubtree(tree, "/calibration/gains")), boost::bad_get);
+
+  // Arrays only convert to strings
+  BOOST_CHECK_EQUAL(get<std::string>(tree, "calibration").value_or(""), "");
+  BOOST_CHECK_EQUAL(convert<std::string>(getLeaf(getSubtree(tree, "/calibration/pedestals"))), "100,-3,7");
+  BOOST_CHECK_THROW(convert<double>(getLeaf(getSubtree(tree, "/calibration/gains"))), boost::bad_lexical_cast);
+
+  // Arrays are values like any other leaf
+  Node changed = tree;
+  BOOST_CHECK(changed == tree);
+  BOOST_CHECK(hash(changed) == hash(tree));
+  boost::get<Branch>(boost::get<Branch>(changed)["calibration"])["gains"] = DoubleArray {1.0, 1.5, 0.75};
+  BOOST_CHECK(changed != tree);
+  BOOST_CHECK(hash(changed) != hash(tree));
+  BOOST_CHECK(hash(Leaf(DoubleArray {0.0})) == hash(Leaf(DoubleArray {-0.0})));
+  BOOST_CHECK(hash(Leaf(DoubleArray {1.0})) != hash(Leaf(IntArray {1})));
+  BOOST_CHECK_EQUAL(diff(tree, changed).size(), 1);
+  BOOST_CHECK_EQUAL(toJson(tree), R"({"calibration":{"gains":[1.0,1.5,0.75,2.0],"pedestals":[100,-3,7]}})");
+  BOOST_CHECK_EQUAL(toIni(tree), "[calibration]\ngains=1.0,1.5,0.75,2.0\npedestals=100,-3,7\n");
+
+  // FlatTree keeps the arrays aligned, in memory and in files
+  Node mixed = Branch {{"a", "x"s}, {"b", DoubleArray {0.5, 0.25}}, {"c", IntArray {}}, {"d", "yz"s}, {"e", IntArray {9}}};
+  FlatTree flatTree(mixed);
+  BOOST_CHECK(flatTree.toNode() == mixed);
+  BOOST_CHECK(flatTree.root().hash() == hash(mixed));
+  auto flatArray = flatTree.getSubtree("b").getArray<double>();
+  BOOST_REQUIRE_EQUAL(flatArray.size(), 2);
+  BOOST_CHECK(flatArray[1] == 0.25);
+  BOOST_CHECK(reinterpret_cast<std::uintptr_t>(flatArray.data()) % ARRAY_ALIGNMENT == 0);
+  BOOST_CHECK(flatTree.getSubtree("b").getArray<std::int64_t>().empty());
+  BOOST_CHECK(flatTree.getSubtree("e").getArray<std::int64_t>()[0] == 9);
+
+  const std::string TEMP_FILE = "/tmp/alice_o2_configuration_test_array_tree.bin";
+  flatTree.writeFile(TEMP_FILE);
+  auto mapped = FlatTree::mapFile(TEMP_FILE, true);
+  BOOST_CHECK(mapped.toNode() == mixed);
+  BOOST_CHECK(reinterpret_cast<std::uintptr_t>(mapped.getSubtree("b").getArray<double>().data()) % ARRAY_ALIGNMENT == 0);
+  std::remove(TEMP_FILE.c_str());
+}
+
+//! [Bind declaration]
+struct Link
+{
+    int id;
+    double gain;
+    bool enabled = true;
+    Tree::Optional<std::string> comment;
+
+    static auto treeFields()
+    {
+      return Tree::fields(
+          Tree::field("id", &Link::id),
+          Tree::field("gain", &Link::gain),
+          Tree::optionalField("enabled", &Link::enabled),
+          Tree::field("comment", &Link::comment));
+    }
+};
+
+struct Equipment
+{
+    std::string name;
+    Link link;
+    Tree::DoubleArray pedestals;
+    Tree::Node extra;
+};
+//! [Bind declaration]
+} // Anonymous namespace
+
+// Structs that cannot be given a treeFields() function can specialise Tree::Fields instead
+template <>
+struct Tree::Fields<Equipment>
+{
+    static auto get()
+    {
+      return fields(
+          field("name", &Equipment::name),
+          field("link", &Equipment::link),
+          field("pedestals", &Equipment::pedestals),
+          field("extra", &Equipment::extra));
+    }
+};
+
+namespace
+{
+/// Tests binding trees to structs
+BOOST_AUTO_TEST_CASE(BindTest)
+{
+  using namespace Tree;
+
+  //! [Bind]
+  Node tree = Branch {
+      {"name", "equipment_1"s},
+      {"link", Branch {{"id", 7}, {"gain", "1.25"s}, {"unused", 0}}},
+      {"pedestals", IntArray {1, 2, 3}},
+      {"extra", Branch {{"anything", true}}}};
+
+  auto equipment = Tree::bind<Equipment>(tree);
+  BOOST_CHECK_EQUAL(equipment.name, "equipment_1");
+  BOOST_CHECK_EQUAL(equipment.link.id, 7);
+  BOOST_CHECK_EQUAL(equipment.link.gain, 1.25); // Converted from the string
+  BOOST_CHECK(equipment.link.enabled); // Kept its default
+  BOOST_CHECK(!equipment.link.comment);
+  BOOST_CHECK(equipment.pedestals == DoubleArray({1.0, 2.0, 3.0}));
+  BOOST_CHECK(equipment.extra == Node(Branch {{"anything", true}}));
+  //! [Bind]
+
+  auto link = Tree::bind<Link>(Branch {{"id", 1}, {"gain", 0.5}, {"enabled", false}, {"comment", "spare"s}});
+  BOOST_CHECK(!link.enabled);
+  BOOST_CHECK_EQUAL(link.comment.value_or(""), "spare");
+
+  // All failures are reported at once
+  Node broken = Branch {
+      {"link", Branch {{"gain", "high"s}, {"enabled", Branch {}}}},
+      {"pedestals", "none"s},
+      {"extra", 1}};
+  try {
+    Tree::bind<Equipment>(broken);
+    BOOST_FAIL("Expected BindError");
+  }
+  catch (const BindError& e) {
+    std::vector<std::string> failures;
+    for (const auto& failure : e.failures()) {
+      failures.push_back(failure.path + ": " + failure.reason);
+    }
+    std::vector<std::string> expected {
+        "/link/enabled: expected a value, found a branch",
+        "/link/gain: cannot convert string \"high\" to the type of the field",
+        "/link/id: missing",
+        "/name: missing",
+        "/pedestals: cannot convert string \"none\" to the type of the field"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(failures.begin(), failures.end(), expected.begin(), expected.end());
+  }
+  BOOST_CHECK_THROW(Tree::bind<Link>(Node(1)), BindError);
+}
+
+/// Tests the shape statistics and memory accounting
+BOOST_AUTO_TEST_CASE(StatsTest)
+{
+  using namespace Tree;
+
+  //! [Stats]
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"enabled", true},
+        {"links", Branch {{"a", 1}, {"b", 2}, {"c", 3}}}}},
+      {"equipment_2", Branch {
+        {"name", "a string that is too long to be stored inline"s},
+        {"gains", DoubleArray {1.0, 2.0}}}},
+      {"version", 1.5}};
+
+  auto treeStats = stats(tree);
+  BOOST_CHECK_EQUAL(treeStats.nodes, 11);
+  BOOST_CHECK_EQUAL(treeStats.branches, 4);
+  BOOST_CHECK_EQUAL(treeStats.leaves, 7);
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.ints, 3);
+  BOOST_CHECK_EQUAL(treeStats.maxDepth, 3);
+  BOOST_CHECK_EQUAL(treeStats.fanout[2], 2); // equipment_1 and equipment_2
+  BOOST_CHECK_EQUAL(treeStats.fanout[3], 2); // The root and links
+  BOOST_CHECK_EQUAL(treeStats.heapBytes, heapBytes(tree));
+  //! [Stats]
+
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.strings, 1);
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.bools, 1);
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.doubles, 1);
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.doubleArrays, 1);
+  BOOST_CHECK_EQUAL(treeStats.leafTypes.intArrays, 0);
+  BOOST_CHECK_EQUAL(treeStats.fanout.size(), 2);
+
+  // The bytes of the children of the root add up to the bytes of the root, minus its own container
+  std::size_t childBytes = 0;
+  for (const auto& child : treeStats.childHeapBytes) {
+    childBytes += child.second;
+  }
+  BOOST_REQUIRE_EQUAL(treeStats.childHeapBytes.size(), 3);
+  BOOST_CHECK(childBytes < treeStats.heapBytes);
+  BOOST_CHECK_EQUAL(treeStats.childHeapBytes["version"], 0);
+  BOOST_CHECK(treeStats.childHeapBytes["equipment_2"] > 46 + 2 * sizeof(double));
+  BOOST_CHECK_EQUAL(treeStats.childHeapBytes["equipment_2"], heapBytes(getSubtree(tree, "equipment_2")));
+
+  // Strings are only counted when they do not fit inline
+  BOOST_CHECK_EQUAL(heapBytes(std::string("short")), 0);
+  BOOST_CHECK(heapBytes(std::string(100, 'x')) > 100);
+  Leaf array = IntArray {1, 2, 3};
+  BOOST_CHECK_EQUAL(heapBytes(array), array.sharedBytes() + 3 * sizeof(std::int64_t));
+
+  auto leafStats = stats(Node(1));
+  BOOST_CHECK_EQUAL(leafStats.nodes, 1);
+  BOOST_CHECK_EQUAL(leafStats.leaves, 1);
+  BOOST_CHECK_EQUAL(leafStats.maxDepth, 0);
+  BOOST_CHECK_EQUAL(leafStats.heapBytes, 0);
+}
+
+/// Tests the compact leaf type
+BOOST_AUTO_TEST_CASE(LeafTest)
+{
+  using namespace Tree;
+
+  BOOST_CHECK_EQUAL(sizeof(Leaf), 16);
+
+  // Short strings and numbers are inline, long strings and arrays are shared by copies
+  Leaf shortString = "fits inline"s;
+  Leaf longString = std::string(100, 'x');
+  BOOST_CHECK(!shortString.isShared());
+  BOOST_CHECK(longString.isShared());
+  BOOST_CHECK(!Leaf(std::string(Leaf::INLINE_CAPACITY, 'x')).isShared());
+  BOOST_CHECK(Leaf(std::string(Leaf::INLINE_CAPACITY + 1, 'x')).isShared());
+  Leaf copy = longString;
+  BOOST_CHECK(copy.getStringView().data() == longString.getStringView().data());
+  BOOST_CHECK(Leaf(1.5).getStringView().empty());
+
+  // It behaves like the boost::variant it replaces
+  BOOST_CHECK(Leaf().getType() == Leaf::Type::String);
+  BOOST_CHECK(Leaf("literal").getType() == Leaf::Type::String);
+  BOOST_CHECK_EQUAL(Leaf(true).which(), 3);
+  BOOST_CHECK(Leaf(1).type() == typeid(int));
+  BOOST_CHECK(Leaf(IntArray {1}).type() == typeid(IntArray));
+  BOOST_CHECK_EQUAL(*Leaf(42).getIf<int>(), 42);
+  BOOST_CHECK(Leaf(42).getIf<double>() == nullptr);
+  BOOST_CHECK_EQUAL(convert<std::string>(longString), std::string(100, 'x'));
+  BOOST_CHECK_EQUAL(convert<int>(Leaf("123"s)), 123);
+  BOOST_CHECK_EQUAL(convert<std::string>(Leaf(false)), "0");
+  BOOST_CHECK_THROW(convert<int>(Leaf("abc"s)), boost::bad_lexical_cast);
+
+  auto describe = [](const Leaf& leaf) {
+    return Visitor::apply<std::string>(leaf,
+        [](const std::string& value) { return "string " + value; },
+        [](int value) { return "int " + std::to_string(value); },
+        [](bool) { return "bool"s; },
+        [](double) { return "double"s; },
+        [](const DoubleArray&) { return "double array"s; },
+        [](const IntArray& value) { return "int array of " + std::to_string(value.size()); });
+  };
+  BOOST_CHECK_EQUAL(describe(shortString), "string fits inline");
+  BOOST_CHECK_EQUAL(describe(copy), "string " + std::string(100, 'x'));
+  BOOST_CHECK_EQUAL(describe(7), "int 7");
+  BOOST_CHECK_EQUAL(describe(true), "bool");
+  BOOST_CHECK_EQUAL(describe(IntArray {1, 2}), "int array of 2");
+
+  BOOST_CHECK(Leaf(1) == Leaf(1));
+  BOOST_CHECK(Leaf(1) != Leaf(true));
+  BOOST_CHECK(Leaf(1) != Leaf(1.0));
+  BOOST_CHECK(Leaf("a"s) < Leaf("b"s));
+  BOOST_CHECK(Leaf("z"s) < Leaf(0)); // Ordered by type first
+  BOOST_CHECK(copy == Leaf(std::string(100, 'x')));
+
+  std::ostringstream stream;
+  stream << shortString << ' ' << Leaf(12) << ' ' << Leaf(true) << ' ' << Leaf(DoubleArray {0.5, 1.0});
+  BOOST_CHECK_EQUAL(stream.str(), "fits inline 12 1 0.5,1");
+
+  // Moving leaves the source an empty string, assigning releases the shared value
+  Leaf moved = std::move(copy);
+  BOOST_CHECK(moved == longString);
+  BOOST_CHECK(copy == Leaf(""s));
+  moved = 5;
+  BOOST_CHECK(moved == Leaf(5));
+  longString = longString;
+  BOOST_CHECK_EQUAL(longString.getStringView().size(), 100);
+}
+
+/// Tests the lookups that do not throw
+BOOST_AUTO_TEST_CASE(FindTest)
+{
+  using namespace Tree;
+
+  //! [Find]
+  Node tree = Branch {
+      {"equipment_1", Branch {
+        {"serial", 33333},
+        {"type", "rorc"s}}}};
+
+  // Optional parameters are probed without exceptions
+  if (const Node* serial = Tree::find(tree, "/equipment_1/serial")) {
+    BOOST_CHECK(getRequired<int>(*serial) == 33333);
+  }
+  BOOST_CHECK(Tree::find(tree, "/equipment_1/threshold") == nullptr);
+  BOOST_CHECK(tryGet<int>(tree, "/equipment_1/serial").get_value_or(-1) == 33333);
+  BOOST_CHECK(tryGet<int>(tree, "/equipment_1/threshold").get_value_or(-1) == -1);
+  //! [Find]
+
+  BOOST_CHECK(Tree::find(tree, "") == &tree);
+  BOOST_CHECK(Tree::find(tree, "/equipment_1/serial/too_deep") == nullptr);
+  BOOST_CHECK(Tree::find(tree, "/equipment_1") == &getSubtree(tree, "/equipment_1"));
+  BOOST_CHECK(Tree::find(getBranch(tree, "equipment_1"), "type") != nullptr);
+  BOOST_CHECK(Tree::find(getBranch(tree, "equipment_1"), "nope") == nullptr);
+
+  // Conversions that fail give nothing instead of throwing
+  BOOST_CHECK(!tryGet<int>(tree, "/equipment_1/type"));
+  BOOST_CHECK(!tryGet<int>(tree, "/equipment_1"));
+  BOOST_CHECK(tryGet<std::string>(tree, "/equipment_1/serial").get_value_or("") == "33333");
+  BOOST_CHECK(tryConvert<double>(Leaf("1.5"s)).get_value_or(0.0) == 1.5);
+  BOOST_CHECK(tryConvert<bool>(Leaf(true)).get_value_or(false));
+  BOOST_CHECK(!tryConvert<int>(Leaf(IntArray {1, 2})));
+  BOOST_CHECK(tryConvert<std::string>(Leaf(IntArray {1, 2})).get_value_or("") == "1,2");
+
+  SharedNode shared(tree);
+  BOOST_CHECK(getRequired<int>(*shared.tryGetSubtree("equipment_1"), "serial") == 33333);
+  BOOST_CHECK(!shared.tryGetSubtree("equipment_2"));
+}
+
 } // Anonymous namespace